@@ -0,0 +1,58 @@
+// Compares two reports written by bench/index.js.
+//
+//   node bench/compare.js base.json head.json [--threshold 10]
+//
+// Prints the change in ns/op for every operation and size present in both
+// reports and exits with status 1 if any got slower by more than the
+// threshold (in percent).
+
+var fs = require('fs')
+
+var args = process.argv.slice(2)
+var threshold = 10
+var files = []
+for (var i = 0; i < args.length; i++) {
+  if (args[i] === '--threshold') {
+    threshold = Number(args[++i])
+  } else {
+    files.push(args[i])
+  }
+}
+
+if (files.length !== 2) {
+  console.error('usage: node bench/compare.js base.json head.json [--threshold 10]')
+  process.exit(2)
+}
+
+function load (file) {
+  var byKey = {}
+  JSON.parse(fs.readFileSync(file, 'utf8')).results.forEach(function (r) {
+    byKey[r.op + ' ' + r.bits] = r
+  })
+  return byKey
+}
+
+var base = load(files[0])
+var head = load(files[1])
+var regressions = 0
+
+Object.keys(head).forEach(function (key) {
+  if (!base[key]) return
+
+  var before = base[key].bignum.nsPerOp
+  var after = head[key].bignum.nsPerOp
+  var change = (after - before) / before * 100
+  var flag = ''
+  if (change > threshold) {
+    flag = '  REGRESSION'
+    regressions++
+  }
+
+  console.log(key + ': ' + before + ' -> ' + after + ' ns/op (' +
+    (change >= 0 ? '+' : '') + change.toFixed(1) + '%)' + flag)
+})
+
+if (regressions > 0) {
+  console.log(regressions + ' regression(s) above ' + threshold + '%')
+  process.exit(1)
+}
@@ -0,0 +1,343 @@
+// Microbenchmarks for bignum against the built-in BigInt.
+//
+//   node bench [--filter re] [--sizes 64,4096] [--time ms] [--out file]
+//
+// Every operation is timed at each operand size up to its own limit. The
+// report is JSON so that two builds can be diffed with bench/compare.js.
+
+var BigNum = require('../')
+var Buffer = require('safe-buffer').Buffer
+var fs = require('fs')
+
+var SIZES = [64, 256, 1024, 4096, 16384, 65536, 262144, 1048576]
+
+function parseArgs (argv) {
+  var opts = { filter: null, sizes: SIZES, time: 200, out: null }
+  for (var i = 0; i < argv.length; i++) {
+    var arg = argv[i]
+    var val = argv[i + 1]
+    if (arg === '--filter') {
+      opts.filter = new RegExp(val)
+      i++
+    } else if (arg === '--sizes') {
+      opts.sizes = val.split(',').map(Number)
+      i++
+    } else if (arg === '--time') {
+      opts.time = Number(val)
+      i++
+    } else if (arg === '--out') {
+      opts.out = val
+      i++
+    } else {
+      throw new Error('Unknown argument ' + arg)
+    }
+  }
+  return opts
+}
+
+// Deterministic operands, so runs of different builds see the same numbers
+var seed = 0x2545f491
+function randomHex (bits) {
+  var digits = Math.ceil(bits / 4)
+  var hex = ''
+  for (var i = 0; i < digits; i++) {
+    seed = (seed * 1103515245 + 12345) >>> 0
+    hex += ((seed >>> 16) & 0xf).toString(16)
+  }
+  // Force the top bit so the operand has exactly `bits` bits
+  return (parseInt(hex[0], 16) | 8).toString(16) + hex.slice(1)
+}
+
+function operand (bits) {
+  var hex = randomHex(bits)
+  return { bn: BigNum(hex, 16), bi: BigInt('0x' + hex), hex: hex }
+}
+
+function modPowBigInt (b, e, m) {
+  var r = BigInt(1)
+  var one = BigInt(1)
+  var zero = BigInt(0)
+  b %= m
+  while (e > zero) {
+    if (e & one) r = r * b % m
+    b = b * b % m
+    e >>= one
+  }
+  return r
+}
+
+// Each entry builds the operands for one size and returns the functions to
+// time; `bigint` is omitted where BigInt has no counterpart.
+var OPS = [
+  {
+    name: 'construct(string)',
+    maxBits: 262144,
+    setup: function (bits) {
+      var s = operand(bits).bn.toString()
+      return {
+        bignum: function () { return BigNum(s) },
+        bigint: function () { return BigInt(s) }
+      }
+    }
+  },
+  {
+    name: 'fromBuffer',
+    setup: function (bits) {
+      var buf = Buffer.from(randomHex(bits), 'hex')
+      return {
+        bignum: function () { return BigNum.fromBuffer(buf) }
+      }
+    }
+  },
+  {
+    name: 'toBuffer',
+    setup: function (bits) {
+      var a = operand(bits)
+      return {
+        bignum: function () { return a.bn.toBuffer() }
+      }
+    }
+  },
+  {
+    name: 'toString(10)',
+    maxBits: 262144,
+    setup: function (bits) {
+      var a = operand(bits)
+      return {
+        bignum: function () { return a.bn.toString() },
+        bigint: function () { return a.bi.toString() }
+      }
+    }
+  },
+  {
+    name: 'toString(16)',
+    setup: function (bits) {
+      var a = operand(bits)
+      return {
+        bignum: function () { return a.bn.toString(16) },
+        bigint: function () { return a.bi.toString(16) }
+      }
+    }
+  },
+  {
+    name: 'add',
+    setup: function (bits) {
+      var a = operand(bits)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.add(b.bn) },
+        bigint: function () { return a.bi + b.bi }
+      }
+    }
+  },
+  {
+    name: 'sub',
+    setup: function (bits) {
+      var a = operand(bits)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.sub(b.bn) },
+        bigint: function () { return a.bi - b.bi }
+      }
+    }
+  },
+  {
+    name: 'mul',
+    setup: function (bits) {
+      var a = operand(bits)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.mul(b.bn) },
+        bigint: function () { return a.bi * b.bi }
+      }
+    }
+  },
+  {
+    name: 'div',
+    setup: function (bits) {
+      var a = operand(bits * 2)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.div(b.bn) },
+        bigint: function () { return a.bi / b.bi }
+      }
+    }
+  },
+  {
+    name: 'mod',
+    setup: function (bits) {
+      var a = operand(bits * 2)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.mod(b.bn) },
+        bigint: function () { return a.bi % b.bi }
+      }
+    }
+  },
+  {
+    name: 'divmod',
+    setup: function (bits) {
+      var a = operand(bits * 2)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.divmod(b.bn) },
+        bigint: function () { return [a.bi / b.bi, a.bi % b.bi] }
+      }
+    }
+  },
+  {
+    name: 'mulMod',
+    setup: function (bits) {
+      var a = operand(bits)
+      var b = operand(bits)
+      var m = operand(bits)
+      return {
+        bignum: function () { return a.bn.mulMod(b.bn, m.bn) },
+        bigint: function () { return a.bi * b.bi % m.bi }
+      }
+    }
+  },
+  {
+    name: 'sqr',
+    setup: function (bits) {
+      var a = operand(bits)
+      return {
+        bignum: function () { return a.bn.sqr() },
+        bigint: function () { return a.bi * a.bi }
+      }
+    }
+  },
+  {
+    name: 'powm',
+    maxBits: 4096,
+    setup: function (bits) {
+      var a = operand(bits)
+      var e = operand(bits)
+      var m = operand(bits)
+      m.bn = m.bn.setBit(0)
+      m.bi = m.bi | BigInt(1)
+      return {
+        bignum: function () { return a.bn.powm(e.bn, m.bn) },
+        bigint: function () { return modPowBigInt(a.bi, e.bi, m.bi) }
+      }
+    }
+  },
+  {
+    name: 'and',
+    setup: function (bits) {
+      var a = operand(bits)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.and(b.bn) },
+        bigint: function () { return a.bi & b.bi }
+      }
+    }
+  },
+  {
+    name: 'shiftLeft',
+    setup: function (bits) {
+      var a = operand(bits)
+      var n = BigInt(17)
+      return {
+        bignum: function () { return a.bn.shiftLeft(17) },
+        bigint: function () { return a.bi << n }
+      }
+    }
+  },
+  {
+    name: 'cmp',
+    setup: function (bits) {
+      var a = operand(bits)
+      var b = operand(bits)
+      return {
+        bignum: function () { return a.bn.cmp(b.bn) },
+        bigint: function () { return a.bi < b.bi ? -1 : a.bi > b.bi ? 1 : 0 }
+      }
+    }
+  },
+  {
+    name: 'sqrt',
+    maxBits: 262144,
+    setup: function (bits) {
+      var a = operand(bits)
+      return {
+        bignum: function () { return a.bn.sqrt() }
+      }
+    }
+  }
+]
+
+// Runs fn in growing batches until `time` ms have passed. Allocations are
+// bignum objects created per call, read from BigNum.memoryUsage().
+function measure (fn, time, countAllocs) {
+  fn()
+
+  var iterations = 0
+  var batch = 1
+  var created = BigNum.memoryUsage().created
+  var start = process.hrtime()
+  var elapsed = 0
+  while (elapsed < time * 1e6) {
+    for (var i = 0; i < batch; i++) fn()
+    iterations += batch
+    var diff = process.hrtime(start)
+    elapsed = diff[0] * 1e9 + diff[1]
+    batch *= 2
+  }
+
+  var result = {
+    iterations: iterations,
+    nsPerOp: Math.round(elapsed / iterations),
+    opsPerSec: Math.round(iterations / (elapsed / 1e9))
+  }
+  if (countAllocs) {
+    result.allocsPerOp = (BigNum.memoryUsage().created - created) / iterations
+  }
+  return result
+}
+
+function run (opts) {
+  var results = []
+
+  OPS.forEach(function (op) {
+    if (opts.filter && !opts.filter.test(op.name)) return
+
+    opts.sizes.forEach(function (bits) {
+      if (op.maxBits && bits > op.maxBits) return
+
+      var fns = op.setup(bits)
+      var entry = {
+        op: op.name,
+        bits: bits,
+        bignum: measure(fns.bignum, opts.time, true),
+        bigint: fns.bigint ? measure(fns.bigint, opts.time, false) : null
+      }
+      if (entry.bigint) {
+        entry.speedup = +(entry.bigint.nsPerOp / entry.bignum.nsPerOp).toFixed(3)
+      }
+      results.push(entry)
+
+      process.stderr.write(op.name + ' ' + bits + ': ' +
+        entry.bignum.nsPerOp + ' ns/op' +
+        (entry.bigint ? ' (BigInt ' + entry.bigint.nsPerOp + ')' : '') + '\n')
+    })
+  })
+
+  return {
+    node: process.version,
+    openssl: process.versions.openssl,
+    arch: process.arch,
+    date: new Date().toISOString(),
+    time: opts.time,
+    results: results
+  }
+}
+
+var opts = parseArgs(process.argv.slice(2))
+var report = JSON.stringify(run(opts), null, 2)
+
+if (opts.out) {
+  fs.writeFileSync(opts.out, report + '\n')
+} else {
+  console.log(report)
+}
@@ -1,19 +1,47 @@
 #include <stdint.h>
+#include <inttypes.h>
+#include <cmath>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
 #include <iostream>
 
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
 #include <nan.h>
 #include <openssl/bn.h>
+#include <openssl/opensslv.h>
+#include <openssl/err.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
 
 using namespace v8;
 using namespace node;
 using namespace std;
 
+// v8::BigInt and its word accessors arrived with V8 6.8 (Node 10.4)
+#if V8_MAJOR_VERSION > 6 || (V8_MAJOR_VERSION == 6 && V8_MINOR_VERSION >= 8)
+#define BIGNUM_HAVE_BIGINT
+#endif
+
+// OpenSSL's bn_get_words, bn_get_top, bn_set_words and bn_get_dmax are
+// internal (crypto/bn/bn_local.h) but exported by libcrypto and by node's
+// bundled copy. Their signatures have not changed from 1.1.0 through 3.x;
+// any other version is not trusted to match and uses the public API only.
+#if !defined(_WIN32) && OPENSSL_VERSION_NUMBER >= 0x10100000L && OPENSSL_VERSION_NUMBER < 0x40000000L
+#define BIGNUM_HAVE_BN_INTERNALS
+#endif
+
 #define REQ_STR_ARG(I, VAR)                                   \
   if (info.Length()<= (I) || !info[I]->IsString()) {          \
     Nan::ThrowTypeError("Argument " #I " must be a string");    \
@@ -64,13 +92,85 @@ using namespace std;
   }                                                           \
   bool VAR = Nan::To<v8::Boolean>(info[I]).ToLocalChecked()->Value();
 
+#define REQ_FUN_ARG(I, VAR)                                   \
+  if (info.Length() <= (I) || !info[I]->IsFunction()) {       \
+    Nan::ThrowTypeError("Argument " #I " must be a function");  \
+    return;                                     \
+  }                                                           \
+  Local<Function> VAR = Local<Function>::Cast(info[I]);
+
 #define WRAP_RESULT(RES, VAR)                                           \
-  Local<Value> arg[1] = { Nan::New<External>(static_cast<BigNum*>(RES)) };  \
-  Local<Object> VAR = Nan::NewInstance(  \
-    Nan::New<FunctionTemplate>(constructor_template)->GetFunction(info.GetIsolate()->GetCurrentContext()).ToLocalChecked(), \
-    1, \
-    arg \
-  ).ToLocalChecked();
+  Local<Object> VAR = BigNum::NewInstance(RES);
+
+/**
+ * Free list of BN_CTX objects, one per thread.
+ *
+ * BN_CTX_new/BN_CTX_free cost a heap round trip on every call, and a freshly
+ * created context has to grow its internal BIGNUM pool again. Keeping released
+ * contexts around lets small-operand arithmetic reuse warm ones. The pool is
+ * thread_local, so the main isolate, worker_threads isolates and libuv pool
+ * threads (async workers) each get their own without locking.
+ */
+class BN_CTX_Pool
+{
+public:
+  static const size_t kMaxPooled = 8;
+
+  size_t created;
+  size_t acquired;
+  size_t inUse;
+  size_t highWater;
+
+  BN_CTX_Pool() : created(0), acquired(0), inUse(0), highWater(0) {}
+
+  ~BN_CTX_Pool()
+  {
+    for (size_t i = 0; i < free_.size(); i++) {
+      BN_CTX_free(free_[i]);
+    }
+  }
+
+  static BN_CTX_Pool& Current()
+  {
+    static thread_local BN_CTX_Pool pool;
+    return pool;
+  }
+
+  BN_CTX* Acquire()
+  {
+    BN_CTX *ctx;
+    if (free_.empty()) {
+      ctx = BN_CTX_new();
+      if (ctx == NULL) {
+        return NULL;
+      }
+      created++;
+    } else {
+      ctx = free_.back();
+      free_.pop_back();
+    }
+    acquired++;
+    if (++inUse > highWater) {
+      highWater = inUse;
+    }
+    return ctx;
+  }
+
+  void Release(BN_CTX *ctx)
+  {
+    inUse--;
+    if (free_.size() < kMaxPooled) {
+      free_.push_back(ctx);
+    } else {
+      BN_CTX_free(ctx);
+    }
+  }
+
+  size_t Pooled() const { return free_.size(); }
+
+private:
+  vector<BN_CTX*> free_;
+};
 
 class AutoBN_CTX
 {
@@ -81,14 +181,14 @@ protected:
 public:
   AutoBN_CTX()
   {
-    ctx = BN_CTX_new();
+    ctx = BN_CTX_Pool::Current().Acquire();
     // TODO: Handle ctx == NULL
   }
 
   ~AutoBN_CTX()
   {
     if (ctx != NULL)
-      BN_CTX_free(ctx);
+      BN_CTX_Pool::Current().Release(ctx);
   }
 
   operator BN_CTX*() { return ctx; }
@@ -183,22 +283,74 @@ endBN_jacobi:
 class BigNum : public Nan::ObjectWrap {
 public:
   static void Initialize(Local<Object> target);
-  BIGNUM* bignum_;
   static Nan::Persistent<Function> js_conditioner;
   static void SetJSConditioner(Local<Function> constructor);
+  static Local<Object> NewInstance(BigNum *res);
+  static bool HasInstance(Local<Value> val);
+  static Nan::MaybeLocal<Object> Convert(Local<Value> val);
+  static BigNum* OutArg(Nan::NAN_METHOD_ARGS_TYPE info, int i);
+  static void ReturnResult(Nan::NAN_METHOD_ARGS_TYPE info, int i, BigNum *res);
+
+  BN_MONT_CTX* MontCtx(BN_CTX *ctx);
+  void InvalidateCache();
+  void TrackMemory();
+
+  BIGNUM* Bn();
+  int NumBits() const;
+  bool IsSmall() const { return small_; }
+  int64_t SmallValue() const { return small_value_; }
+  void SetSmall(int64_t v);
+  static bool FitsSmall(int64_t v) { return v != INT64_MIN; }
+
+  BigNum();
+  ~BigNum();
 
 protected:
+  /**
+   * Values whose magnitude fits 63 bits live inline in small_value_, which
+   * spares counters and amounts the BIGNUM heap allocation and the OpenSSL
+   * call overhead. bignum_ is created on first use; once Bn() hands it out
+   * it holds the value until SetSmall() switches back, and it is kept
+   * allocated for reuse either way.
+   */
+  BIGNUM *bignum_;
+  bool small_;
+  int64_t small_value_;
+
   static Nan::Persistent<FunctionTemplate> constructor_template;
+  static Nan::Persistent<ObjectTemplate> instance_template;
+
+  // Montgomery context for this value used as a modulus, built on first use
+  BN_MONT_CTX *mont_;
+
+  // Bytes last reported to V8 for this object; zero until it is wrapped
+  int64_t accounted_;
+  // Process-wide totals for memoryUsage(), shared by every isolate that
+  // creates values, hence atomic
+  static atomic<uint64_t> liveObjects;
+  static atomic<uint64_t> createdObjects;
+  static atomic<int64_t> nativeBytes;
 
   BigNum(const Nan::Utf8String& str, uint64_t base);
   BigNum(uint64_t num);
   BigNum(int64_t num);
+  BigNum(double num);
   BigNum(BIGNUM *num);
-  BigNum();
-  ~BigNum();
 
   static NAN_METHOD(New);
   static NAN_METHOD(ToString);
+  static NAN_METHOD(Add);
+  static NAN_METHOD(Sub);
+  static NAN_METHOD(Mul);
+  static NAN_METHOD(Div);
+  static NAN_METHOD(Mod);
+  static NAN_METHOD(Iadd);
+  static NAN_METHOD(Isub);
+  static NAN_METHOD(Imul);
+  static NAN_METHOD(Idiv);
+  static NAN_METHOD(Imod);
+  static NAN_METHOD(Cmp);
+  static NAN_METHOD(ToNumber);
   static NAN_METHOD(Badd);
   static NAN_METHOD(Bsub);
   static NAN_METHOD(Bmul);
@@ -220,906 +372,5440 @@ protected:
   static NAN_METHOD(Brand0);
   static NAN_METHOD(Uprime0);
   static NAN_METHOD(Probprime);
+  static NAN_METHOD(Uprime0Async);
+  static NAN_METHOD(UprimeParallel);
+  static NAN_METHOD(ProbprimeAsync);
+  static NAN_METHOD(Bnextprime);
+  static NAN_METHOD(BnextprimeAsync);
+  static NAN_METHOD(BpowmAsync);
+  static NAN_METHOD(CtxPoolStats);
+  static NAN_METHOD(MemoryUsage);
+  static NAN_METHOD(EnableStats);
+  static NAN_METHOD(Stats);
+  static NAN_METHOD(ResetStats);
+  static NAN_METHOD(Bsum);
+  static NAN_METHOD(Bproduct);
+  static NAN_METHOD(Baddmany);
+  static NAN_METHOD(Bmulmany);
+  static NAN_METHOD(Bmodmany);
+  static NAN_METHOD(Bevalexpr);
+  static NAN_METHOD(Bmultipowm);
+  static NAN_METHOD(FromBuffer);
+  static NAN_METHOD(ToBuffer);
   static NAN_METHOD(Bcompare);
   static NAN_METHOD(Scompare);
   static NAN_METHOD(Ucompare);
   static NAN_METHOD(Band);
   static NAN_METHOD(Bor);
   static NAN_METHOD(Bxor);
+  static NAN_METHOD(Bandnot);
+  static NAN_METHOD(Bnot);
+  static NAN_METHOD(Bsetbit);
+  static NAN_METHOD(Bclearbit);
+  static NAN_METHOD(Bmaskbits);
+  static NAN_METHOD(Bpopcount);
+  static NAN_METHOD(Bfrombigint);
+  static NAN_METHOD(Btobigint);
   static NAN_METHOD(Binvertm);
   static NAN_METHOD(Bsqrt);
+  static NAN_METHOD(Bsqrtrem);
+  static NAN_METHOD(Bdivmod);
+  static NAN_METHOD(Bmuladd);
+  static NAN_METHOD(Bmulmod);
+  static NAN_METHOD(Baddmod);
+  static NAN_METHOD(Bsubmod);
+  static NAN_METHOD(Bsqr);
   static NAN_METHOD(Broot);
+  static NAN_METHOD(Bisperfectpower);
   static NAN_METHOD(BitLength);
   static NAN_METHOD(Bgcd);
   static NAN_METHOD(Bjacobi);
   static NAN_METHOD(Bsetcompact);
+  static NAN_METHOD(Bgetcompact);
+  static NAN_METHOD(Bencode);
+  static NAN_METHOD(Bdecode);
   static NAN_METHOD(IsBitSet);
-  static Local<Value> Bop(Nan::NAN_METHOD_ARGS_TYPE info, int op);
+  static void Bop(Nan::NAN_METHOD_ARGS_TYPE info, int op);
+  static void Arith(Nan::NAN_METHOD_ARGS_TYPE info, int op, bool inPlace);
+  static void BatchMap(Nan::NAN_METHOD_ARGS_TYPE info, int op);
+
 };
 
 Nan::Persistent<FunctionTemplate> BigNum::constructor_template;
+Nan::Persistent<ObjectTemplate> BigNum::instance_template;
 
 Nan::Persistent<Function> BigNum::js_conditioner;
 
+atomic<uint64_t> BigNum::liveObjects(0);
+atomic<uint64_t> BigNum::createdObjects(0);
+atomic<int64_t> BigNum::nativeBytes(0);
+
 void BigNum::SetJSConditioner(Local<Function> constructor) {
   js_conditioner.Reset(constructor);
 }
 
-void BigNum::Initialize(v8::Local<v8::Object> target) {
-  Nan::HandleScope scope;
-
-  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
-  constructor_template.Reset(tmpl);
-
-  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
-  tmpl->SetClassName(Nan::New("BigNum").ToLocalChecked());
-
-  Nan::SetMethod(tmpl, "uprime0", Uprime0);
-
-  Nan::SetPrototypeMethod(tmpl, "tostring", ToString);
-  Nan::SetPrototypeMethod(tmpl, "badd", Badd);
-  Nan::SetPrototypeMethod(tmpl, "bsub", Bsub);
-  Nan::SetPrototypeMethod(tmpl, "bmul", Bmul);
-  Nan::SetPrototypeMethod(tmpl, "bdiv", Bdiv);
-  Nan::SetPrototypeMethod(tmpl, "uadd", Uadd);
-  Nan::SetPrototypeMethod(tmpl, "usub", Usub);
-  Nan::SetPrototypeMethod(tmpl, "umul", Umul);
-  Nan::SetPrototypeMethod(tmpl, "udiv", Udiv);
-  Nan::SetPrototypeMethod(tmpl, "umul2exp", Umul_2exp);
-  Nan::SetPrototypeMethod(tmpl, "udiv2exp", Udiv_2exp);
-  Nan::SetPrototypeMethod(tmpl, "babs", Babs);
-  Nan::SetPrototypeMethod(tmpl, "bneg", Bneg);
-  Nan::SetPrototypeMethod(tmpl, "bmod", Bmod);
-  Nan::SetPrototypeMethod(tmpl, "umod", Umod);
-  Nan::SetPrototypeMethod(tmpl, "bpowm", Bpowm);
-  Nan::SetPrototypeMethod(tmpl, "upowm", Upowm);
-  Nan::SetPrototypeMethod(tmpl, "upow", Upow);
-  Nan::SetPrototypeMethod(tmpl, "brand0", Brand0);
-  Nan::SetPrototypeMethod(tmpl, "probprime", Probprime);
-  Nan::SetPrototypeMethod(tmpl, "bcompare", Bcompare);
-  Nan::SetPrototypeMethod(tmpl, "scompare", Scompare);
-  Nan::SetPrototypeMethod(tmpl, "ucompare", Ucompare);
-  Nan::SetPrototypeMethod(tmpl, "band", Band);
-  Nan::SetPrototypeMethod(tmpl, "bor", Bor);
-  Nan::SetPrototypeMethod(tmpl, "bxor", Bxor);
-  Nan::SetPrototypeMethod(tmpl, "binvertm", Binvertm);
-  Nan::SetPrototypeMethod(tmpl, "bsqrt", Bsqrt);
-  Nan::SetPrototypeMethod(tmpl, "broot", Broot);
-  Nan::SetPrototypeMethod(tmpl, "bitLength", BitLength);
-  Nan::SetPrototypeMethod(tmpl, "gcd", Bgcd);
-  Nan::SetPrototypeMethod(tmpl, "jacobi", Bjacobi);
-  Nan::SetPrototypeMethod(tmpl, "setCompact", Bsetcompact);
-  Nan::SetPrototypeMethod(tmpl, "isbitset", IsBitSet);
-
-  v8::Isolate *isolate = v8::Isolate::GetCurrent();
-  Nan::Set(target, Nan::New("BigNum").ToLocalChecked(), tmpl->GetFunction(isolate->GetCurrentContext()).ToLocalChecked());
-}
-
-BigNum::BigNum(const Nan::Utf8String& str, uint64_t base) : Nan::ObjectWrap (),
-    bignum_(BN_new())
+/**
+ * Wraps a native result in a new JS object. Instantiating the cached instance
+ * template directly gives an object with BigNum.prototype without calling the
+ * constructor function, which would otherwise re-enter BigNum::New.
+ */
+Local<Object> BigNum::NewInstance(BigNum *res)
 {
-  BN_zero(bignum_);
+  Nan::EscapableHandleScope scope;
 
-  BIGNUM *res = bignum_;
+  Local<Object> obj = Nan::NewInstance(Nan::New<ObjectTemplate>(instance_template)).ToLocalChecked();
+  res->Wrap(obj);
+  res->TrackMemory();
 
-  const char *cstr = *str;
-  switch (base) {
-  case 2:
-    for (int i = 0, l = str.length(); i < l; i++) {
-      if (cstr[l-i-1] != '0') {
-        BN_set_bit(bignum_, i);
-      }
-    }
-    break;
-  case 10:
-    BN_dec2bn(&res, cstr);
-    break;
-  case 16:
-    BN_hex2bn(&res, cstr);
-    break;
-  default:
-    Nan::ThrowError("Invalid base, only 10 and 16 are supported");
-    return;
-  }
+  return scope.Escape(obj);
 }
 
-BigNum::BigNum(uint64_t num) : Nan::ObjectWrap (),
-    bignum_(BN_new())
+bool BigNum::HasInstance(Local<Value> val)
 {
-  if (sizeof(BN_ULONG) >= 8 || num <= 0xFFFFFFFFL) {
-    BN_set_word(bignum_, num);
-  } else {
-    BN_set_word(bignum_, num >> 32);
-    BN_lshift(bignum_, bignum_, 32);
-    BN_add_word(bignum_, num & 0xFFFFFFFFL);
-  }
+  return Nan::New<FunctionTemplate>(constructor_template)->HasInstance(val);
 }
 
-BigNum::BigNum(int64_t num) : Nan::ObjectWrap (),
-    bignum_(BN_new())
+// Runs the constructor on val, as BigNum(val) would from JS.
+Nan::MaybeLocal<Object> BigNum::Convert(Local<Value> val)
 {
-  bool neg = (num < 0);
-
-  if (neg) {
-    num = -num;
-  }
-  if (num < 0) { // num is -2^63
-    BN_one(bignum_);
-    BN_lshift(bignum_, bignum_, 63);
-  } else if (sizeof(BN_ULONG) >= 8 || num <= 0xFFFFFFFFL) {
-    BN_set_word(bignum_, num);
-  } else {
-    BN_set_word(bignum_, num >> 32);
-    BN_lshift(bignum_, bignum_, 32);
-    BN_add_word(bignum_, num & 0xFFFFFFFFL);
-  }
-  if (neg) {
-    BN_set_negative(bignum_, 1);
-  }
+  Local<Value> argv[] = { val };
+  return Nan::NewInstance(Nan::New<FunctionTemplate>(constructor_template)->GetFunction(Nan::GetCurrentContext()).ToLocalChecked(), 1, argv);
 }
 
-BigNum::BigNum(BIGNUM *num) : Nan::ObjectWrap (),
-    bignum_(BN_new())
+/**
+ * Arithmetic methods accept an optional trailing BigNum to write the result
+ * into instead of allocating a new one. The JS side uses this for in-place
+ * variants (iadd, imul, ...) by passing the receiver itself.
+ */
+BigNum* BigNum::OutArg(Nan::NAN_METHOD_ARGS_TYPE info, int i)
 {
-  BN_copy(bignum_, num);
+  if (info.Length() > i && HasInstance(info[i])) {
+    return Nan::ObjectWrap::Unwrap<BigNum>(info[i].As<Object>());
+  }
+  return new BigNum();
 }
 
-BigNum::BigNum() : Nan::ObjectWrap (),
-    bignum_(BN_new())
+void BigNum::ReturnResult(Nan::NAN_METHOD_ARGS_TYPE info, int i, BigNum *res)
 {
-  BN_zero(bignum_);
+  if (info.Length() > i && HasInstance(info[i])) {
+    res->InvalidateCache();
+    res->TrackMemory();
+    info.GetReturnValue().Set(info[i]);
+  } else {
+    info.GetReturnValue().Set(NewInstance(res));
+  }
 }
 
-BigNum::~BigNum()
+/**
+ * Opt-in instrumentation of the native methods. Each one is registered
+ * through Instrumented<Fn>::Register(), whose trampoline only tests a flag
+ * while stats are off. When they are on it counts calls, native time
+ * (wrapping the result included) and a log2 histogram of the bit length of
+ * the largest BigNum operand. The counters are process-wide, but nothing
+ * ties the methods to one thread: Initialize may run once per context that
+ * loads the addon, each with its own thread calling in. So the table is
+ * built only once and every counter is a relaxed atomic.
+ */
+class MethodStats
 {
-  BN_clear_free(bignum_);
-}
+public:
+  // Bucket k counts operands of up to 2^k bits
+  static const int kBuckets = 33;
 
-NAN_METHOD(BigNum::New)
-{
-  if (!info.IsConstructCall()) {
-    int len = info.Length();
-    Local<Value>* newArgs = new Local<Value>[len];
-    for (int i = 0; i < len; i++) {
-      newArgs[i] = info[i];
-    }
+  struct Entry
+  {
+    const char *name;
+    atomic<uint64_t> calls;
+    atomic<uint64_t> ns;
+    atomic<uint64_t> bits[kBuckets];
+  };
 
-    Nan::TryCatch tryCatch;
-    Nan::MaybeLocal<Object> newInstMaybeLocal = Nan::NewInstance(
-        Nan::New<FunctionTemplate>(constructor_template)->GetFunction(info.GetIsolate()->GetCurrentContext()).ToLocalChecked(), len, newArgs);
-    if (tryCatch.HasCaught()) {
-        tryCatch.ReThrow();
-        return;
-    }
+  static atomic<bool> enabled;
 
-    Local<Value> newInst = newInstMaybeLocal.ToLocalChecked();
-    delete[] newArgs;
-    info.GetReturnValue().Set(newInst);
-    return;
+  static Entry *Add(const char *name)
+  {
+    Entry *e = new Entry();
+    e->name = name;
+    Clear(e);
+    lock_guard<mutex> lock(Lock());
+    All().push_back(e);
+    return e;
   }
 
-  BigNum *bignum;
-  uint64_t base;
+  // Callers hold Lock() while walking the table
+  static vector<Entry*>& All()
+  {
+    static vector<Entry*> entries;
+    return entries;
+  }
 
-  Local<Context> currentContext = info.GetIsolate()->GetCurrentContext();
+  static mutex& Lock()
+  {
+    static mutex lock;
+    return lock;
+  }
 
-  if (info[0]->IsExternal()) {
-    bignum = static_cast<BigNum*>(External::Cast(*(info[0]))->Value());
-  } else {
-    int len = info.Length();
-    Local<Object> ctx = Nan::New<Object>();
-    Local<Value>* newArgs = new Local<Value>[len];
-    for (int i = 0; i < len; i++) {
-      newArgs[i] = info[i];
+  static void Clear(Entry *e)
+  {
+    e->calls.store(0, memory_order_relaxed);
+    e->ns.store(0, memory_order_relaxed);
+    for (int k = 0; k < kBuckets; k++) {
+      e->bits[k].store(0, memory_order_relaxed);
     }
-    Local<Value> obj;
-    const int ok = Nan::New<Function>(js_conditioner)->
-      Call(currentContext, ctx, info.Length(), newArgs).ToLocal(&obj);
-    delete[] newArgs;
+  }
 
-    if (!ok) {
-      Nan::ThrowError("Invalid type passed to bignum constructor");
-      return;
+  static void Record(Entry *e, int bits, uint64_t ns)
+  {
+    int bucket = 0;
+    while (bucket < kBuckets - 1 && ((uint64_t) 1 << bucket) < (uint64_t) bits) {
+      bucket++;
     }
-
-    Nan::Utf8String str(Nan::Get(obj->ToObject(currentContext).ToLocalChecked(), Nan::New("num").ToLocalChecked()).ToLocalChecked()->ToString(currentContext).ToLocalChecked());
-    base = Nan::To<int64_t>(Nan::Get(obj->ToObject(currentContext).ToLocalChecked(), Nan::New("base").ToLocalChecked()).ToLocalChecked()).FromJust();
-
-    bignum = new BigNum(str, base);
+    e->calls.fetch_add(1, memory_order_relaxed);
+    e->ns.fetch_add(ns, memory_order_relaxed);
+    e->bits[bucket].fetch_add(1, memory_order_relaxed);
   }
 
-  bignum->Wrap(info.This());
+  static int OperandBits(Nan::NAN_METHOD_ARGS_TYPE info)
+  {
+    int bits = 0;
+    if (BigNum::HasInstance(info.This())) {
+      bits = Nan::ObjectWrap::Unwrap<BigNum>(info.This())->NumBits();
+    }
+    for (int i = 0; i < info.Length(); i++) {
+      if (BigNum::HasInstance(info[i])) {
+        bits = max(bits, Nan::ObjectWrap::Unwrap<BigNum>(info[i].As<Object>())->NumBits());
+      }
+    }
+    return bits;
+  }
+};
 
-  info.GetReturnValue().Set(info.This());
-}
+atomic<bool> MethodStats::enabled(false);
 
-NAN_METHOD(BigNum::ToString)
+template <Nan::FunctionCallback Fn>
+class Instrumented
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+public:
+  static Nan::FunctionCallback Register(const char *name)
+  {
+    static once_flag once;
+    call_once(once, [name]() { entry_ = MethodStats::Add(name); });
+    return Call;
+  }
 
-  uint64_t base = 10;
+private:
+  static MethodStats::Entry *entry_;
 
-  if (info.Length() > 0) {
-    REQ_UINT64_ARG(0, tbase);
-    base = tbase;
-  }
-  char *to = NULL;
-  switch (base) {
-  case 10:
-    to = BN_bn2dec(bignum->bignum_);
-    break;
-  case 16:
-    to = BN_bn2hex(bignum->bignum_);
-    break;
-  default:
-    Nan::ThrowError("Invalid base, only 10 and 16 are supported");
-    return;
+  static void Call(Nan::NAN_METHOD_ARGS_TYPE info)
+  {
+    if (!MethodStats::enabled.load(memory_order_relaxed)) {
+      Fn(info);
+      return;
+    }
+
+    int bits = MethodStats::OperandBits(info);
+    uint64_t start = uv_hrtime();
+    Fn(info);
+    MethodStats::Record(entry_, bits, uv_hrtime() - start);
   }
+};
 
-  Local<Value> result = Nan::New<String>(to).ToLocalChecked();
-  OPENSSL_free(to);
+template <Nan::FunctionCallback Fn>
+MethodStats::Entry *Instrumented<Fn>::entry_ = NULL;
 
-  info.GetReturnValue().Set(result);
-}
+#define SET_METHOD(TMPL, NAME, FN)                            \
+  Nan::SetMethod(TMPL, NAME, Instrumented<FN>::Register(NAME))
 
-NAN_METHOD(BigNum::Badd)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+#define SET_PROTOTYPE_METHOD(TMPL, NAME, FN)                  \
+  Nan::SetPrototypeMethod(TMPL, NAME, Instrumented<FN>::Register(NAME))
 
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
+void BigNum::Initialize(v8::Local<v8::Object> target) {
+  Nan::HandleScope scope;
 
-  BN_add(res->bignum_, bignum->bignum_, bn->bignum_);
+  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
+  constructor_template.Reset(tmpl);
 
-  WRAP_RESULT(res, result);
+  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tmpl->SetClassName(Nan::New("BigNum").ToLocalChecked());
+  instance_template.Reset(tmpl->InstanceTemplate());
+
+  SET_METHOD(tmpl, "uprime0", Uprime0);
+  SET_METHOD(tmpl, "uprime0Async", Uprime0Async);
+  SET_METHOD(tmpl, "uprimeParallel", UprimeParallel);
+  SET_METHOD(tmpl, "ctxPoolStats", CtxPoolStats);
+  SET_METHOD(tmpl, "memoryUsage", MemoryUsage);
+  Nan::SetMethod(tmpl, "enableStats", EnableStats);
+  Nan::SetMethod(tmpl, "stats", Stats);
+  Nan::SetMethod(tmpl, "resetStats", ResetStats);
+  SET_METHOD(tmpl, "frombuffer", FromBuffer);
+  SET_METHOD(tmpl, "bdecode", Bdecode);
+  SET_METHOD(tmpl, "bsum", Bsum);
+  SET_METHOD(tmpl, "bfrombigint", Bfrombigint);
+  SET_METHOD(tmpl, "bproduct", Bproduct);
+  SET_METHOD(tmpl, "baddmany", Baddmany);
+  SET_METHOD(tmpl, "bmulmany", Bmulmany);
+  SET_METHOD(tmpl, "bmodmany", Bmodmany);
+  SET_METHOD(tmpl, "bevalexpr", Bevalexpr);
+  SET_METHOD(tmpl, "bmultipowm", Bmultipowm);
+
+  SET_PROTOTYPE_METHOD(tmpl, "tostring", ToString);
+  SET_PROTOTYPE_METHOD(tmpl, "toNumber", ToNumber);
+  SET_PROTOTYPE_METHOD(tmpl, "tobuffer", ToBuffer);
+  SET_PROTOTYPE_METHOD(tmpl, "add", Add);
+  SET_PROTOTYPE_METHOD(tmpl, "sub", Sub);
+  SET_PROTOTYPE_METHOD(tmpl, "mul", Mul);
+  SET_PROTOTYPE_METHOD(tmpl, "div", Div);
+  SET_PROTOTYPE_METHOD(tmpl, "mod", Mod);
+  SET_PROTOTYPE_METHOD(tmpl, "iadd", Iadd);
+  SET_PROTOTYPE_METHOD(tmpl, "isub", Isub);
+  SET_PROTOTYPE_METHOD(tmpl, "imul", Imul);
+  SET_PROTOTYPE_METHOD(tmpl, "idiv", Idiv);
+  SET_PROTOTYPE_METHOD(tmpl, "imod", Imod);
+  SET_PROTOTYPE_METHOD(tmpl, "cmp", Cmp);
+  SET_PROTOTYPE_METHOD(tmpl, "bencode", Bencode);
+  SET_PROTOTYPE_METHOD(tmpl, "badd", Badd);
+  SET_PROTOTYPE_METHOD(tmpl, "bsub", Bsub);
+  SET_PROTOTYPE_METHOD(tmpl, "bmul", Bmul);
+  SET_PROTOTYPE_METHOD(tmpl, "bdiv", Bdiv);
+  SET_PROTOTYPE_METHOD(tmpl, "uadd", Uadd);
+  SET_PROTOTYPE_METHOD(tmpl, "usub", Usub);
+  SET_PROTOTYPE_METHOD(tmpl, "umul", Umul);
+  SET_PROTOTYPE_METHOD(tmpl, "udiv", Udiv);
+  SET_PROTOTYPE_METHOD(tmpl, "umul2exp", Umul_2exp);
+  SET_PROTOTYPE_METHOD(tmpl, "udiv2exp", Udiv_2exp);
+  SET_PROTOTYPE_METHOD(tmpl, "babs", Babs);
+  SET_PROTOTYPE_METHOD(tmpl, "bneg", Bneg);
+  SET_PROTOTYPE_METHOD(tmpl, "bmod", Bmod);
+  SET_PROTOTYPE_METHOD(tmpl, "umod", Umod);
+  SET_PROTOTYPE_METHOD(tmpl, "bpowm", Bpowm);
+  SET_PROTOTYPE_METHOD(tmpl, "upowm", Upowm);
+  SET_PROTOTYPE_METHOD(tmpl, "upow", Upow);
+  SET_PROTOTYPE_METHOD(tmpl, "brand0", Brand0);
+  SET_PROTOTYPE_METHOD(tmpl, "probprime", Probprime);
+  SET_PROTOTYPE_METHOD(tmpl, "probprimeAsync", ProbprimeAsync);
+  SET_PROTOTYPE_METHOD(tmpl, "bnextprime", Bnextprime);
+  SET_PROTOTYPE_METHOD(tmpl, "bnextprimeAsync", BnextprimeAsync);
+  SET_PROTOTYPE_METHOD(tmpl, "bpowmAsync", BpowmAsync);
+  SET_PROTOTYPE_METHOD(tmpl, "bcompare", Bcompare);
+  SET_PROTOTYPE_METHOD(tmpl, "scompare", Scompare);
+  SET_PROTOTYPE_METHOD(tmpl, "ucompare", Ucompare);
+  SET_PROTOTYPE_METHOD(tmpl, "band", Band);
+  SET_PROTOTYPE_METHOD(tmpl, "bor", Bor);
+  SET_PROTOTYPE_METHOD(tmpl, "bxor", Bxor);
+  SET_PROTOTYPE_METHOD(tmpl, "bandnot", Bandnot);
+  SET_PROTOTYPE_METHOD(tmpl, "bnot", Bnot);
+  SET_PROTOTYPE_METHOD(tmpl, "bsetbit", Bsetbit);
+  SET_PROTOTYPE_METHOD(tmpl, "bclearbit", Bclearbit);
+  SET_PROTOTYPE_METHOD(tmpl, "bmaskbits", Bmaskbits);
+  SET_PROTOTYPE_METHOD(tmpl, "bpopcount", Bpopcount);
+  SET_PROTOTYPE_METHOD(tmpl, "btobigint", Btobigint);
+  SET_PROTOTYPE_METHOD(tmpl, "binvertm", Binvertm);
+  SET_PROTOTYPE_METHOD(tmpl, "bsqrt", Bsqrt);
+  SET_PROTOTYPE_METHOD(tmpl, "bsqrtrem", Bsqrtrem);
+  SET_PROTOTYPE_METHOD(tmpl, "bdivmod", Bdivmod);
+  SET_PROTOTYPE_METHOD(tmpl, "bmuladd", Bmuladd);
+  SET_PROTOTYPE_METHOD(tmpl, "bmulmod", Bmulmod);
+  SET_PROTOTYPE_METHOD(tmpl, "baddmod", Baddmod);
+  SET_PROTOTYPE_METHOD(tmpl, "bsubmod", Bsubmod);
+  SET_PROTOTYPE_METHOD(tmpl, "bsqr", Bsqr);
+  SET_PROTOTYPE_METHOD(tmpl, "broot", Broot);
+  SET_PROTOTYPE_METHOD(tmpl, "bisperfectpower", Bisperfectpower);
+  SET_PROTOTYPE_METHOD(tmpl, "bitLength", BitLength);
+  SET_PROTOTYPE_METHOD(tmpl, "gcd", Bgcd);
+  SET_PROTOTYPE_METHOD(tmpl, "jacobi", Bjacobi);
+  SET_PROTOTYPE_METHOD(tmpl, "setCompact", Bsetcompact);
+  SET_PROTOTYPE_METHOD(tmpl, "getCompact", Bgetcompact);
+  SET_PROTOTYPE_METHOD(tmpl, "isbitset", IsBitSet);
 
-  info.GetReturnValue().Set(result);
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  Nan::Set(target, Nan::New("BigNum").ToLocalChecked(), tmpl->GetFunction(isolate->GetCurrentContext()).ToLocalChecked());
 }
 
-NAN_METHOD(BigNum::Bsub)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
-  BN_sub(res->bignum_, bignum->bignum_, bn->bignum_);
+static const char kRadixDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
 
-  WRAP_RESULT(res, result);
+// Below this many words, radix conversion uses the quadratic word-at-a-time
+// loops; above it, divide and conquer on cached powers of the radix.
+static const int kRadixBaseCaseWords = 32;
 
-  info.GetReturnValue().Set(result);
+static int
+radixDigitValue(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+  return 36;
 }
 
-NAN_METHOD(BigNum::Bmul)
+static int
+radixBitsPerDigit(unsigned int base)
 {
-  AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
-  BN_mul(res->bignum_, bignum->bignum_, bn->bignum_, ctx);
-
-  WRAP_RESULT(res, result);
-
-  info.GetReturnValue().Set(result);
+  switch (base) {
+  case 2: return 1;
+  case 4: return 2;
+  case 8: return 3;
+  case 16: return 4;
+  case 32: return 5;
+  default: return 0;
+  }
 }
 
-NAN_METHOD(BigNum::Bdiv)
+static int
+bn_num_words(const BIGNUM *a)
 {
-  AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *bi = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
-  BN_div(res->bignum_, NULL, bignum->bignum_, bi->bignum_, ctx);
-
-  WRAP_RESULT(res, result);
-
-  info.GetReturnValue().Set(result);
+  return (BN_num_bits(a) + BN_BITS2 - 1) / BN_BITS2;
 }
 
-NAN_METHOD(BigNum::Uadd)
+/**
+ * r = a * b for non-negative operands of very different lengths. BN_mul
+ * only takes its Karatsuba path when both operands have (nearly) the same
+ * number of words and falls back to schoolbook multiplication otherwise, so
+ * the longer operand is split into pieces about as long as the shorter one.
+ */
+static void
+mul_split(BIGNUM *r, const BIGNUM *a, const BIGNUM *b, BN_CTX *ctx)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  REQ_UINT64_ARG(0, x);
-  BigNum *res = new BigNum(bignum->bignum_);
-  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
-    BN_add_word(res->bignum_, x);
-  } else {
-    BigNum *bn = new BigNum(x);
-    BN_add(res->bignum_, bignum->bignum_, bn->bignum_);
+  int aw = bn_num_words(a);
+  int bw = bn_num_words(b);
+  if (aw > bw) {
+    std::swap(a, b);
+    std::swap(aw, bw);
+  }
+  if (aw < kRadixBaseCaseWords || bw <= aw + 1) {
+    BN_mul(r, a, b, ctx);
+    return;
   }
 
-  WRAP_RESULT(res, result);
-
-  info.GetReturnValue().Set(result);
+  // b = hi * 2^shift + lo, with lo the size of a, or half of b if larger
+  int shift = max(aw, bw / 2) * BN_BITS2;
+
+  BN_CTX_start(ctx);
+  BIGNUM *hi = BN_CTX_get(ctx);
+  BIGNUM *lo = BN_CTX_get(ctx);
+  BIGNUM *t = BN_CTX_get(ctx);
+  BN_rshift(hi, b, shift);
+  BN_copy(lo, b);
+  BN_mask_bits(lo, shift);
+
+  mul_split(t, a, hi, ctx);
+  BN_lshift(t, t, shift);
+  mul_split(r, a, lo, ctx);
+  BN_add(r, r, t);
+  BN_CTX_end(ctx);
 }
 
-NAN_METHOD(BigNum::Usub)
+/**
+ * Powers b^(k * 2^i) of a radix b, where b^k is the largest power of b that
+ * fits in a BN_ULONG. Each power splits a number into a high and a low half
+ * for divide and conquer conversion. The powers and their Barrett
+ * reciprocals are cached per thread, so repeated conversions of large values
+ * only pay for them once.
+ */
+class RadixPowers
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+public:
+  unsigned int base;
+  unsigned int chunkDigits;
+  BN_ULONG chunk;
 
-  REQ_UINT64_ARG(0, x);
-  BigNum *res = new BigNum(bignum->bignum_);
-  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
-    BN_sub_word(res->bignum_, x);
-  } else {
-    BigNum *bn = new BigNum(x);
-    BN_sub(res->bignum_, bignum->bignum_, bn->bignum_);
-  }
+  RadixPowers() : base(0), chunkDigits(0), chunk(0) {}
 
-  WRAP_RESULT(res, result);
+  ~RadixPowers()
+  {
+    for (size_t i = 0; i < powers_.size(); i++) {
+      BN_free(powers_[i]);
+      BN_free(mu_[i]);
+    }
+  }
 
-  info.GetReturnValue().Set(result);
-}
+  static RadixPowers& ForBase(unsigned int base)
+  {
+    static thread_local RadixPowers cache[37];
+    RadixPowers &rp = cache[base];
+    if (rp.base == 0) {
+      rp.base = base;
+      rp.chunk = base;
+      rp.chunkDigits = 1;
+      while (rp.chunk <= ((BN_ULONG) -1) / base) {
+        rp.chunk *= base;
+        rp.chunkDigits++;
+      }
+    }
+    return rp;
+  }
 
-NAN_METHOD(BigNum::Umul)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  // Number of radix digits in Power(i)'s low half, i.e. log_b(Power(i)).
+  size_t Digits(int i) const { return (size_t) chunkDigits << i; }
 
-  REQ_UINT64_ARG(0, x);
-  BigNum *res = new BigNum(bignum->bignum_);
-  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
-    BN_mul_word(res->bignum_, x);
-  } else {
-    AutoBN_CTX ctx;
-    BigNum *bn = new BigNum(x);
-    BN_mul(res->bignum_, bignum->bignum_, bn->bignum_, ctx);
+  const BIGNUM* Power(int i, BN_CTX *ctx)
+  {
+    while ((int) powers_.size() <= i) {
+      BIGNUM *p = BN_new();
+      if (powers_.empty()) {
+        BN_set_word(p, chunk);
+      } else {
+        // BN_sqr only uses Karatsuba for power-of-two word counts
+        BN_mul(p, powers_.back(), powers_.back(), ctx);
+      }
+      powers_.push_back(p);
+      mu_.push_back(NULL);
+    }
+    return powers_[i];
   }
 
-  WRAP_RESULT(res, result);
+  /**
+   * q = x / Power(i), r = x % Power(i) for 0 <= x < Power(i)^2 by Barrett
+   * reduction (HAC 14.42), so the cost is two multiplications rather than a
+   * schoolbook division.
+   */
+  void DivRem(BIGNUM *q, BIGNUM *r, const BIGNUM *x, int i, BN_CTX *ctx)
+  {
+    const BIGNUM *p = Power(i, ctx);
+    const BIGNUM *mu = Mu(i, ctx);
+    int m = BN_num_bits(p);
+
+    BN_CTX_start(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    BN_rshift(t, x, m - 1);
+    mul_split(q, t, mu, ctx);
+    BN_rshift(q, q, m + 1);
+    mul_split(t, q, p, ctx);
+    BN_sub(r, x, t);
+    while (BN_ucmp(r, p) >= 0) {
+      BN_sub(r, r, p);
+      BN_add_word(q, 1);
+    }
+    BN_CTX_end(ctx);
+  }
 
-  info.GetReturnValue().Set(result);
-}
+private:
+  vector<BIGNUM*> powers_;
+  vector<BIGNUM*> mu_;
 
-NAN_METHOD(BigNum::Udiv)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  // floor(2^(2m) / Power(i)), where m is the bit length of Power(i)
+  const BIGNUM* Mu(int i, BN_CTX *ctx)
+  {
+    const BIGNUM *p = Power(i, ctx);
+    if (mu_[i] != NULL) {
+      return mu_[i];
+    }
+    int m = BN_num_bits(p);
+    BIGNUM *mu = BN_new();
+
+    BN_CTX_start(ctx);
+    BIGNUM *e = BN_CTX_get(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    if (i == 0) {
+      BN_zero(t);
+      BN_set_bit(t, 2 * m);
+      BN_div(mu, NULL, t, p, ctx);
+    } else {
+      // Power(i) = Power(i - 1)^2, so squaring the previous reciprocal gives
+      // half the bits and a single Newton step the rest:
+      // mu += mu * (2^(2m) - p * mu) / 2^(2m)
+      const BIGNUM *prev = Mu(i - 1, ctx);
+      BN_mul(mu, prev, prev, ctx);
+      BN_rshift(mu, mu, 4 * BN_num_bits(powers_[i - 1]) - 2 * m);
+
+      mul_split(t, p, mu, ctx);
+      BN_zero(e);
+      BN_set_bit(e, 2 * m);
+      BN_sub(e, e, t);
+      int neg = BN_is_negative(e);
+      BN_set_negative(e, 0);
+      mul_split(t, mu, e, ctx);
+      BN_rshift(t, t, 2 * m);
+      if (neg) {
+        BN_sub(mu, mu, t);
+      } else {
+        BN_add(mu, mu, t);
+      }
 
-  REQ_UINT64_ARG(0, x);
-  BigNum *res = new BigNum(bignum->bignum_);
-  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
-    BN_div_word(res->bignum_, x);
-  } else {
-    AutoBN_CTX ctx;
-    BigNum *bn = new BigNum(x);
-    BN_div(res->bignum_, NULL, bignum->bignum_, bn->bignum_, ctx);
+      // Settle the last few units so that 0 <= 2^(2m) - p * mu < p
+      mul_split(t, p, mu, ctx);
+      BN_zero(e);
+      BN_set_bit(e, 2 * m);
+      BN_sub(e, e, t);
+      while (BN_is_negative(e)) {
+        BN_sub_word(mu, 1);
+        BN_add(e, e, p);
+      }
+      while (BN_cmp(e, p) >= 0) {
+        BN_add_word(mu, 1);
+        BN_sub(e, e, p);
+      }
+    }
+    BN_CTX_end(ctx);
+
+    mu_[i] = mu;
+    return mu;
   }
+};
 
-  WRAP_RESULT(res, result);
+// r = value of the len valid digits at s. Splits at a cached power so that
+// both halves are combined with one (Karatsuba-sized) multiplication.
+static void
+radixParse(BIGNUM *r, const char *s, size_t len, RadixPowers &rp, BN_CTX *ctx)
+{
+  if (len <= kRadixBaseCaseWords * rp.chunkDigits) {
+    BN_zero(r);
+    size_t pos = 0;
+    while (pos < len) {
+      size_t n = (pos == 0 && len % rp.chunkDigits) ? len % rp.chunkDigits : rp.chunkDigits;
+      BN_ULONG word = 0, mul = 1;
+      for (size_t j = 0; j < n; j++) {
+        word = word * rp.base + radixDigitValue(s[pos + j]);
+        mul *= rp.base;
+      }
+      BN_mul_word(r, mul);
+      BN_add_word(r, word);
+      pos += n;
+    }
+    return;
+  }
 
-  info.GetReturnValue().Set(result);
+  int i = 0;
+  while (rp.Digits(i + 1) < len) {
+    i++;
+  }
+  size_t low = rp.Digits(i);
+
+  BN_CTX_start(ctx);
+  BIGNUM *hi = BN_CTX_get(ctx);
+  BIGNUM *lo = BN_CTX_get(ctx);
+  radixParse(hi, s, len - low, rp, ctx);
+  radixParse(lo, s + len - low, low, rp, ctx);
+  mul_split(r, hi, rp.Power(i, ctx), ctx);
+  BN_add(r, r, lo);
+  BN_CTX_end(ctx);
 }
 
-NAN_METHOD(BigNum::Umul_2exp)
+// Appends the digits of 0 <= x < Power(i + 1) to out. With pad > 0 exactly
+// pad digits are written, zero-filled on the left; x must be below b^pad.
+static void
+radixPrint(string &out, const BIGNUM *x, int i, size_t pad,
+           RadixPowers &rp, BN_CTX *ctx)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  if (i < 0 || BN_num_bits(x) <= kRadixBaseCaseWords * BN_BITS2) {
+    BN_CTX_start(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    BN_copy(t, x);
+
+    string rev;
+    while (!BN_is_zero(t)) {
+      BN_ULONG word = BN_div_word(t, rp.chunk);
+      for (unsigned int j = 0; j < rp.chunkDigits; j++) {
+        rev.push_back(kRadixDigits[word % rp.base]);
+        word /= rp.base;
+      }
+    }
+    BN_CTX_end(ctx);
 
-  REQ_UINT32_ARG(0, x);
-  BigNum *res = new BigNum();
-  BN_lshift(res->bignum_, bignum->bignum_, x);
+    if (pad > 0) {
+      rev.resize(pad, '0');
+    } else {
+      while (rev.size() > 1 && rev[rev.size() - 1] == '0') {
+        rev.erase(rev.size() - 1);
+      }
+      if (rev.empty()) {
+        rev.push_back('0');
+      }
+    }
+    out.append(rev.rbegin(), rev.rend());
+    return;
+  }
 
-  WRAP_RESULT(res, result);
+  if (BN_ucmp(x, rp.Power(i, ctx)) < 0) {
+    radixPrint(out, x, i - 1, pad, rp, ctx);
+    return;
+  }
 
-  info.GetReturnValue().Set(result);
+  BN_CTX_start(ctx);
+  BIGNUM *q = BN_CTX_get(ctx);
+  BIGNUM *r = BN_CTX_get(ctx);
+  rp.DivRem(q, r, x, i, ctx);
+  radixPrint(out, q, i - 1, pad > 0 ? pad - rp.Digits(i) : 0, rp, ctx);
+  radixPrint(out, r, i - 1, rp.Digits(i), rp, ctx);
+  BN_CTX_end(ctx);
 }
 
-NAN_METHOD(BigNum::Udiv_2exp)
+/**
+ * Parses a number in any base from 2 to 36: an optional '-' followed by
+ * digits, case-insensitive, up to the first character that is not a digit
+ * in that base. Power-of-two bases are unpacked bit by bit in linear time;
+ * the others go through radixParse.
+ */
+static void
+BN_radix2bn(BIGNUM *bn, const char *str, unsigned int base)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  bool neg = (*str == '-');
+  if (neg) {
+    str++;
+  }
 
-  REQ_UINT32_ARG(0, x);
-  BigNum *res = new BigNum();
-  BN_rshift(res->bignum_, bignum->bignum_, x);
+  size_t len = 0;
+  while (radixDigitValue(str[len]) < (int) base) {
+    len++;
+  }
 
-  WRAP_RESULT(res, result);
+  int bpd = radixBitsPerDigit(base);
+  if (bpd > 0) {
+    vector<unsigned char> le((len * bpd + 7) / 8 + 1, 0);
+    for (size_t d = 0; d < len; d++) {
+      size_t bit = d * bpd;
+      unsigned int v = radixDigitValue(str[len - 1 - d]) << (bit % 8);
+      le[bit / 8] |= v & 0xff;
+      le[bit / 8 + 1] |= v >> 8;
+    }
+    BN_lebin2bn(&le[0], le.size(), bn);
+  } else {
+    AutoBN_CTX ctx;
+    radixParse(bn, str, len, RadixPowers::ForBase(base), ctx);
+  }
 
-  info.GetReturnValue().Set(result);
+  BN_set_negative(bn, neg);
 }
 
-NAN_METHOD(BigNum::Babs)
+// Formats a number in any base from 2 to 36 with lowercase digits.
+static string
+BN_bn2radix(const BIGNUM *bn, unsigned int base)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  string out;
+  if (BN_is_negative(bn)) {
+    out.push_back('-');
+  }
 
-  BigNum *res = new BigNum(bignum->bignum_);
-  BN_set_negative(res->bignum_, 0);
+  int bpd = radixBitsPerDigit(base);
+  if (bpd > 0) {
+    int bits = BN_num_bits(bn);
+    if (bits == 0) {
+      return "0";
+    }
+    size_t nbytes = BN_num_bytes(bn);
+    vector<unsigned char> le(nbytes + 2, 0);
+    BN_bn2lebinpad(bn, &le[0], nbytes);
+    for (int d = (bits + bpd - 1) / bpd - 1; d >= 0; d--) {
+      size_t bit = (size_t) d * bpd;
+      unsigned int v = (le[bit / 8] | (le[bit / 8 + 1] << 8)) >> (bit % 8);
+      out.push_back(kRadixDigits[v & (base - 1)]);
+    }
+    return out;
+  }
 
-  WRAP_RESULT(res, result);
+  AutoBN_CTX ctx;
+  RadixPowers &rp = RadixPowers::ForBase(base);
+
+  BN_CTX_start(ctx);
+  BIGNUM *x = BN_CTX_get(ctx);
+  BN_copy(x, bn);
+  BN_set_negative(x, 0);
+
+  // Start at the smallest power whose square is known to exceed x
+  int top = -1;
+  if (BN_num_bits(x) > kRadixBaseCaseWords * BN_BITS2) {
+    top = 0;
+    while (BN_num_bits(x) > 2 * (BN_num_bits(rp.Power(top, ctx)) - 1)) {
+      top++;
+    }
+  }
+  radixPrint(out, x, top, 0, rp, ctx);
+  BN_CTX_end(ctx);
 
-  info.GetReturnValue().Set(result);
+  return out;
 }
 
-NAN_METHOD(BigNum::Bneg)
+BigNum::BigNum(const Nan::Utf8String& str, uint64_t base) : Nan::ObjectWrap (),
+    bignum_(BN_new()), small_(false), small_value_(0), mont_(NULL), accounted_(0)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *res = new BigNum(bignum->bignum_);
-  BN_set_negative(res->bignum_, !BN_is_negative(res->bignum_));
+  BN_zero(bignum_);
 
-  WRAP_RESULT(res, result);
+  if (base < 2 || base > 36) {
+    Nan::ThrowError("Invalid base, only 2 to 36 are supported");
+    return;
+  }
 
-  info.GetReturnValue().Set(result);
+  BN_radix2bn(bignum_, *str, base);
 }
 
-NAN_METHOD(BigNum::Bmod)
+// Sets bn to a 64-bit magnitude, also when BN_ULONG is only 32 bits wide.
+static void
+BN_set_u64(BIGNUM *bn, uint64_t num)
 {
-  AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
-  BN_div(NULL, res->bignum_, bignum->bignum_, bn->bignum_, ctx);
+  if (sizeof(BN_ULONG) >= 8 || num <= 0xFFFFFFFFL) {
+    BN_set_word(bn, num);
+  } else {
+    BN_set_word(bn, num >> 32);
+    BN_lshift(bn, bn, 32);
+    BN_add_word(bn, num & 0xFFFFFFFFL);
+  }
+}
 
-  WRAP_RESULT(res, result);
+// Returns the low 64 bits of the magnitude of bn.
+static uint64_t
+BN_get_u64(const BIGNUM *bn)
+{
+  if (sizeof(BN_ULONG) >= 8 && BN_num_bits(bn) <= 64) {
+    return BN_get_word(bn);
+  }
 
-  info.GetReturnValue().Set(result);
+  unsigned char buf[8];
+  uint64_t num = 0;
+  BIGNUM *low = BN_dup(bn);
+  BN_set_negative(low, 0);
+  BN_mask_bits(low, 64);
+  BN_bn2binpad(low, buf, sizeof(buf));
+  BN_free(low);
+  for (size_t i = 0; i < sizeof(buf); i++) {
+    num = (num << 8) | buf[i];
+  }
+  return num;
 }
 
-NAN_METHOD(BigNum::Umod)
+/**
+ * Converts to the nearest double, rounding half to even like parseInt() on
+ * the decimal representation does. Values past the double range give
+ * +/-Infinity.
+ */
+static double
+BN_get_double(const BIGNUM *bn)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  int bits = BN_num_bits(bn);
+  double d;
 
-  REQ_UINT64_ARG(0, x);
-  BigNum *res = new BigNum();
-  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
-    BN_set_word(res->bignum_, BN_mod_word(bignum->bignum_, x));
+  if (bits <= 64) {
+    d = (double) BN_get_u64(bn);
   } else {
-    AutoBN_CTX ctx;
-    BigNum *bn = new BigNum(x);
-    BN_div(NULL, res->bignum_, bignum->bignum_, bn->bignum_, ctx);
+    BIGNUM *top = BN_new();
+    BN_rshift(top, bn, bits - 64);
+    uint64_t mant = BN_get_u64(top);
+    BN_free(top);
+
+    // The discarded low bits only matter as a sticky bit for rounding.
+    for (int i = 0; i < bits - 64; i++) {
+      if (BN_is_bit_set(bn, i)) {
+        mant |= 1;
+        break;
+      }
+    }
+    d = ldexp((double) mant, bits - 64);
   }
 
-  WRAP_RESULT(res, result);
+  return BN_is_negative(bn) ? -d : d;
+}
 
-  info.GetReturnValue().Set(result);
+BigNum::BigNum(uint64_t num) : Nan::ObjectWrap (),
+    bignum_(NULL), small_(true), small_value_(0), mont_(NULL), accounted_(0)
+{
+  if (num <= (uint64_t) INT64_MAX) {
+    small_value_ = (int64_t) num;
+  } else {
+    small_ = false;
+    bignum_ = BN_new();
+    BN_set_u64(bignum_, num);
+  }
 }
 
-NAN_METHOD(BigNum::Bpowm)
+BigNum::BigNum(int64_t num) : Nan::ObjectWrap (),
+    bignum_(NULL), small_(true), small_value_(num), mont_(NULL), accounted_(0)
 {
-  AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  if (!FitsSmall(num)) {
+    small_ = false;
+    bignum_ = BN_new();
+    BN_set_u64(bignum_, 0 - (uint64_t) num);
+    BN_set_negative(bignum_, 1);
+  }
+}
 
-  BigNum *bn1 = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *bn2 = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
-  BN_mod_exp(res->bignum_, bignum->bignum_, bn1->bignum_, bn2->bignum_, ctx);
+/**
+ * Converts a JS number exactly, truncating any fraction. Doubles at or above
+ * 2^64 are built from their 53-bit mantissa and binary exponent, so large
+ * values like 1e+100 come out exact without a round trip through a string.
+ * NaN and the infinities give zero.
+ */
+static void
+BN_set_double(BIGNUM *bn, double num)
+{
+  BN_zero(bn);
+  if (!std::isfinite(num)) {
+    return;
+  }
 
-  WRAP_RESULT(res, result);
+  bool neg = (num < 0);
+  num = std::trunc(std::fabs(num));
 
-  info.GetReturnValue().Set(result);
+  if (num < 18446744073709551616.0) {
+    BN_set_u64(bn, (uint64_t) num);
+  } else {
+    int exp;
+    double frac = frexp(num, &exp);
+    BN_set_u64(bn, (uint64_t) ldexp(frac, 53));
+    BN_lshift(bn, bn, exp - 53);
+  }
+  if (neg) {
+    BN_set_negative(bn, 1);
+  }
 }
 
-NAN_METHOD(BigNum::Upowm)
+BigNum::BigNum(double num) : Nan::ObjectWrap (),
+    bignum_(NULL), small_(true), small_value_(0), mont_(NULL), accounted_(0)
 {
-  AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  if (std::fabs(num) < 9223372036854775808.0) {
+    small_value_ = (int64_t) num;
+  } else if (std::isfinite(num)) {
+    small_ = false;
+    bignum_ = BN_new();
+    BN_set_double(bignum_, num);
+  }
+}
 
-  REQ_UINT64_ARG(0, x);
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *exp = new BigNum(x);
+BigNum::BigNum(BIGNUM *num) : Nan::ObjectWrap (),
+    bignum_(BN_new()), small_(false), small_value_(0), mont_(NULL), accounted_(0)
+{
+  BN_copy(bignum_, num);
+}
 
-  BigNum *res = new BigNum();
-  BN_mod_exp(res->bignum_, bignum->bignum_, exp->bignum_, bn->bignum_, ctx);
+BigNum::BigNum() : Nan::ObjectWrap (),
+    bignum_(NULL), small_(true), small_value_(0), mont_(NULL), accounted_(0)
+{
+}
 
-  WRAP_RESULT(res, result);
+// Nan::AdjustExternalMemory takes an int, so deltas past 2 GiB go in steps
+// rather than being truncated.
+static void
+adjustExternalMemory(int64_t delta)
+{
+  const int64_t step = INT_MAX;
+  while (delta > step || delta < -step) {
+    Nan::AdjustExternalMemory((int) (delta > 0 ? step : -step));
+    delta -= delta > 0 ? step : -step;
+  }
+  if (delta != 0) {
+    Nan::AdjustExternalMemory((int) delta);
+  }
+}
 
-  info.GetReturnValue().Set(result);
+BigNum::~BigNum()
+{
+  InvalidateCache();
+  if (bignum_ != NULL) {
+    BN_clear_free(bignum_);
+  }
+
+  if (accounted_ != 0) {
+    adjustExternalMemory(-accounted_);
+    nativeBytes.fetch_sub(accounted_, memory_order_relaxed);
+    liveObjects.fetch_sub(1, memory_order_relaxed);
+  }
 }
 
-NAN_METHOD(BigNum::Upow)
+/**
+ * The value as a BIGNUM, materializing an inline small value first. This
+ * mutates the object (it may allocate bignum_ and clears small_), so it is
+ * not a read: call it on the JS thread only, and hand the returned pointer
+ * to any other thread that needs the value.
+ */
+BIGNUM* BigNum::Bn()
 {
-  AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  if (bignum_ == NULL) {
+    bignum_ = BN_new();
+  }
+  if (small_) {
+    BN_set_u64(bignum_, small_value_ < 0 ? 0 - (uint64_t) small_value_ : (uint64_t) small_value_);
+    BN_set_negative(bignum_, small_value_ < 0);
+    small_ = false;
+  }
+  return bignum_;
+}
 
-  REQ_UINT64_ARG(0, x);
-  BigNum *exp = new BigNum(x);
+// Same as BN_num_bits(Bn()), without materializing a small value.
+int BigNum::NumBits() const
+{
+  if (!small_) {
+    return BN_num_bits(bignum_);
+  }
+  uint64_t m = small_value_ < 0 ? 0 - (uint64_t) small_value_ : (uint64_t) small_value_;
+  int bits = 0;
+  for (; m != 0; m >>= 1) {
+    bits++;
+  }
+  return bits;
+}
 
-  BigNum *res = new BigNum();
-  BN_exp(res->bignum_, bignum->bignum_, exp->bignum_, ctx);
+// Makes v the value; v must pass FitsSmall().
+void BigNum::SetSmall(int64_t v)
+{
+  small_ = true;
+  small_value_ = v;
+}
 
-  WRAP_RESULT(res, result);
+/**
+ * Returns a Montgomery context for reduction modulo this value, or NULL if
+ * the value is not a positive odd number. The context is cached, so repeated
+ * powm() calls against the same modulus object skip BN_MONT_CTX_set.
+ */
+BN_MONT_CTX* BigNum::MontCtx(BN_CTX *ctx)
+{
+  if (mont_ != NULL) {
+    return mont_;
+  }
+  BIGNUM *m = Bn();
+  if (!BN_is_odd(m) || BN_is_negative(m)) {
+    return NULL;
+  }
 
-  info.GetReturnValue().Set(result);
+  mont_ = BN_MONT_CTX_new();
+  if (mont_ != NULL && !BN_MONT_CTX_set(mont_, m, ctx)) {
+    BN_MONT_CTX_free(mont_);
+    mont_ = NULL;
+  }
+  return mont_;
 }
 
-NAN_METHOD(BigNum::Brand0)
+/**
+ * Bytes of limb storage behind a BIGNUM. Node's OpenSSL exports the internal
+ * bn_get_dmax, which also counts slack left behind by earlier, larger values;
+ * its prototype is an ABI assumption, see BIGNUM_HAVE_BN_INTERNALS. Elsewhere
+ * the words in use are the best estimate available.
+ */
+static size_t
+bn_allocated_bytes(const BIGNUM *a)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+#ifdef BIGNUM_HAVE_BN_INTERNALS
+  static int (*getDmax)(const BIGNUM *a) =
+    (int (*)(const BIGNUM*)) dlsym(RTLD_DEFAULT, "bn_get_dmax");
+  if (getDmax != NULL) {
+    return (size_t) getDmax(a) * sizeof(BN_ULONG);
+  }
+#endif
+  return (size_t) ((BN_num_bits(a) + BN_BITS2 - 1) / BN_BITS2) * sizeof(BN_ULONG);
+}
 
-  BigNum *res = new BigNum();
+/**
+ * Tells V8 how much native memory this object holds, so that many large
+ * values push the GC to run instead of only growing RSS. Called when the
+ * object is wrapped and after every in-place change; event loop only, which
+ * is why values still private to a worker thread are not counted.
+ */
+void BigNum::TrackMemory()
+{
+  int64_t size = sizeof(BigNum) + (bignum_ != NULL ? bn_allocated_bytes(bignum_) : 0);
 
-  BN_rand_range(res->bignum_, bignum->bignum_);
+  if (accounted_ == 0) {
+    liveObjects.fetch_add(1, memory_order_relaxed);
+    createdObjects.fetch_add(1, memory_order_relaxed);
+  }
+  if (size != accounted_) {
+    adjustExternalMemory(size - accounted_);
+    nativeBytes.fetch_add(size - accounted_, memory_order_relaxed);
+    accounted_ = size;
+  }
+}
 
-  WRAP_RESULT(res, result);
+// Must be called whenever bignum_ is modified in place.
+void BigNum::InvalidateCache()
+{
+  if (mont_ != NULL) {
+    BN_MONT_CTX_free(mont_);
+    mont_ = NULL;
+  }
+}
 
-  info.GetReturnValue().Set(result);
+/**
+ * r = a^p mod m using a precomputed Montgomery context. Single-word bases
+ * take the cheaper BN_mod_exp_mont_word path, as BN_mod_exp itself does.
+ */
+static int
+mod_exp_mont(BIGNUM *r, const BIGNUM *a, const BIGNUM *p, const BIGNUM *m,
+             BN_CTX *ctx, BN_MONT_CTX *mont)
+{
+  if (!BN_is_negative(a) && BN_num_bits(a) <= BN_BITS2) {
+    return BN_mod_exp_mont_word(r, BN_get_word(a), p, m, ctx, mont);
+  }
+  return BN_mod_exp_mont(r, a, p, m, ctx, mont);
 }
 
-NAN_METHOD(BigNum::Uprime0)
+// r = a^p mod m, reusing m's cached Montgomery context when it has one.
+static int
+mod_exp(BIGNUM *r, const BIGNUM *a, const BIGNUM *p, BigNum *m, BN_CTX *ctx)
 {
-  REQ_UINT32_ARG(0, x);
-  REQ_BOOL_ARG(1, safe);
+  BN_MONT_CTX *mont = m->MontCtx(ctx);
+  if (mont != NULL) {
+    return mod_exp_mont(r, a, p, m->Bn(), ctx, mont);
+  }
+  return BN_mod_exp(r, a, p, m->Bn(), ctx);
+}
 
-  BigNum *res = new BigNum();
+#ifdef BIGNUM_HAVE_BIGINT
+static void BN_from_bigint(BIGNUM *bn, Local<BigInt> value);
+#endif
 
-  BN_generate_prime_ex(res->bignum_, x, safe, NULL, NULL, NULL);
+NAN_METHOD(BigNum::New)
+{
+  if (!info.IsConstructCall()) {
+    int len = info.Length();
+    Local<Value>* newArgs = new Local<Value>[len];
+    for (int i = 0; i < len; i++) {
+      newArgs[i] = info[i];
+    }
 
-  WRAP_RESULT(res, result);
+    Nan::TryCatch tryCatch;
+    Nan::MaybeLocal<Object> newInstMaybeLocal = Nan::NewInstance(
+        Nan::New<FunctionTemplate>(constructor_template)->GetFunction(info.GetIsolate()->GetCurrentContext()).ToLocalChecked(), len, newArgs);
+    if (tryCatch.HasCaught()) {
+        tryCatch.ReThrow();
+        return;
+    }
 
-  info.GetReturnValue().Set(result);
-}
+    Local<Value> newInst = newInstMaybeLocal.ToLocalChecked();
+    delete[] newArgs;
+    info.GetReturnValue().Set(newInst);
+    return;
+  }
 
-NAN_METHOD(BigNum::Probprime)
+  BigNum *bignum;
+
+  if (info[0]->IsNumber()) {
+    bignum = new BigNum(Nan::To<double>(info[0]).FromJust());
+  } else if (info[0]->IsString()) {
+    Nan::Utf8String str(info[0]);
+    uint64_t base = 10;
+    if (info.Length() > 1 && !info[1]->IsNullOrUndefined()) {
+      // Strings such as '16' are accepted, as they always were
+      Nan::Maybe<int64_t> b = Nan::To<int64_t>(info[1]);
+      if (b.IsNothing()) {
+        return;
+      }
+      if (b.FromJust() < 2 || b.FromJust() > 36) {
+        Nan::ThrowRangeError("Invalid base, only 2 to 36 are supported");
+        return;
+      }
+      base = b.FromJust();
+    }
+
+    if (strstr(*str, "e+") != NULL || strstr(*str, "e-") != NULL) {
+      // Exponent notation is read as a JS number would be, then floored
+      bignum = new BigNum(floor(strtod(*str, NULL)));
+    } else {
+      bignum = new BigNum(str, base);
+    }
+  } else if (HasInstance(info[0])) {
+    BigNum *src = Nan::ObjectWrap::Unwrap<BigNum>(info[0].As<Object>());
+    bignum = src->IsSmall() ? new BigNum(src->SmallValue()) : new BigNum(src->Bn());
+#ifdef BIGNUM_HAVE_BIGINT
+  } else if (info[0]->IsBigInt()) {
+    bignum = new BigNum();
+    BN_from_bigint(bignum->Bn(), info[0].As<BigInt>());
+#endif
+  } else {
+    // Anything else is stringified by BigNum.conditionArgs in JS
+    Local<Context> currentContext = info.GetIsolate()->GetCurrentContext();
+
+    int len = info.Length();
+    Local<Object> ctx = Nan::New<Object>();
+    Local<Value>* newArgs = new Local<Value>[len];
+    for (int i = 0; i < len; i++) {
+      newArgs[i] = info[i];
+    }
+    Local<Value> obj;
+    const int ok = Nan::New<Function>(js_conditioner)->
+      Call(currentContext, ctx, info.Length(), newArgs).ToLocal(&obj);
+    delete[] newArgs;
+
+    if (!ok) {
+      Nan::ThrowError("Invalid type passed to bignum constructor");
+      return;
+    }
+
+    Nan::Utf8String str(Nan::Get(obj->ToObject(currentContext).ToLocalChecked(), Nan::New("num").ToLocalChecked()).ToLocalChecked()->ToString(currentContext).ToLocalChecked());
+    uint64_t base = Nan::To<int64_t>(Nan::Get(obj->ToObject(currentContext).ToLocalChecked(), Nan::New("base").ToLocalChecked()).ToLocalChecked()).FromJust();
+
+    bignum = new BigNum(str, base);
+  }
+
+  bignum->Wrap(info.This());
+  bignum->TrackMemory();
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(BigNum::ToString)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  uint64_t base = 10;
+
+  if (info.Length() > 0) {
+    REQ_UINT64_ARG(0, tbase);
+    base = tbase;
+  }
+  Local<Value> result;
+  if (base == 16) {
+    // Kept on BN_bn2hex for its whole-byte output, e.g. "0A"
+    char *to = BN_bn2hex(bignum->Bn());
+    result = Nan::New<String>(to).ToLocalChecked();
+    OPENSSL_free(to);
+  } else if (base == 10 && bignum->IsSmall()) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%" PRId64, bignum->SmallValue());
+    result = Nan::New<String>(buf).ToLocalChecked();
+  } else if (base >= 2 && base <= 36) {
+    result = Nan::New<String>(BN_bn2radix(bignum->Bn(), base)).ToLocalChecked();
+  } else {
+    Nan::ThrowError("Invalid base, only 2 to 36 are supported");
+    return;
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+// Reverses the byte order within each size-byte word of a buffer, which
+// converts between big and little endian words in place.
+static void
+reverseWords(unsigned char *data, size_t len, size_t size)
+{
+  for (size_t i = 0; i + size <= len; i += size) {
+    std::reverse(data + i, data + i + size);
+  }
+}
+
+NAN_METHOD(BigNum::ToNumber)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  if (bignum->IsSmall()) {
+    info.GetReturnValue().Set(Nan::New<Number>((double) bignum->SmallValue()));
+    return;
+  }
+  info.GetReturnValue().Set(Nan::New<Number>(BN_get_double(bignum->Bn())));
+}
+
+NAN_METHOD(BigNum::FromBuffer)
+{
+  if (info.Length() < 1 || !node::Buffer::HasInstance(info[0])) {
+    Nan::ThrowTypeError("Argument 0 must be a Buffer");
+    return;
+  }
+  REQ_UINT32_ARG(1, size);
+  REQ_BOOL_ARG(2, little);
+
+  const unsigned char *data = (const unsigned char *) node::Buffer::Data(info[0]);
+  size_t len = node::Buffer::Length(info[0]);
+
+  if (size == 0 || len % size != 0) {
+    Nan::ThrowRangeError("Buffer length must be a multiple of size");
+    return;
+  }
+
+  BigNum *res = new BigNum();
+  if (!little || size == 1) {
+    BN_bin2bn(data, len, res->Bn());
+  } else if (size == len) {
+    BN_lebin2bn(data, len, res->Bn());
+  } else {
+    vector<unsigned char> tmp(data, data + len);
+    reverseWords(&tmp[0], len, size);
+    BN_bin2bn(&tmp[0], len, res->Bn());
+  }
+
+  info.GetReturnValue().Set(NewInstance(res));
+}
+
+/**
+ * tobuffer(size, little[, target, offset])
+ *
+ * Serializes the magnitude big endian, zero-padded to a whole number of
+ * size-byte words (size 0 means a single word of the minimal length), then
+ * swaps the bytes of each word for little endian output. Without a target a
+ * new Buffer is returned; with one, the bytes are written at offset and the
+ * number of bytes written is returned.
+ */
+NAN_METHOD(BigNum::ToBuffer)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, size);
+  REQ_BOOL_ARG(1, little);
+
+  if (BN_is_negative(bignum->Bn())) {
+    Nan::ThrowError("converting negative numbers to Buffers not supported yet");
+    return;
+  }
+
+  size_t nbytes = max(BN_num_bytes(bignum->Bn()), 1);
+  if (size == 0) {
+    size = nbytes;
+  }
+  size_t len = (nbytes + size - 1) / size * size;
+
+  bool toTarget = info.Length() > 2 && node::Buffer::HasInstance(info[2]);
+  Local<Object> buf;
+  unsigned char *data;
+  if (toTarget) {
+    REQ_UINT32_ARG(3, offset);
+    size_t avail = node::Buffer::Length(info[2]);
+    if (offset > avail || len > avail - offset) {
+      Nan::ThrowRangeError("Target buffer is too small");
+      return;
+    }
+    data = (unsigned char *) node::Buffer::Data(info[2]) + offset;
+  } else {
+    buf = Nan::NewBuffer(len).ToLocalChecked();
+    data = (unsigned char *) node::Buffer::Data(buf);
+  }
+
+  BN_bn2binpad(bignum->Bn(), data, len);
+  if (little && size > 1) {
+    reverseWords(data, len, size);
+  }
+
+  if (toTarget) {
+    info.GetReturnValue().Set(Nan::New<Number>(len));
+  } else {
+    info.GetReturnValue().Set(buf);
+  }
+}
+
+NAN_METHOD(BigNum::Badd)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 1);
+
+  BN_add(res->Bn(), bignum->Bn(), bn->Bn());
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bsub)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 1);
+  BN_sub(res->Bn(), bignum->Bn(), bn->Bn());
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bmul)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 1);
+  BN_mul(res->Bn(), bignum->Bn(), bn->Bn(), ctx);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bdiv)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bi = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 1);
+  BN_div(res->Bn(), NULL, bignum->Bn(), bi->Bn(), ctx);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Uadd)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  BN_copy(res->Bn(), bignum->Bn());
+  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
+    BN_add_word(res->Bn(), x);
+  } else {
+    AutoBN_CTX ctx;
+    BN_CTX_start(ctx);
+    BIGNUM *bn = BN_CTX_get(ctx);
+    BN_set_u64(bn, x);
+    BN_add(res->Bn(), bignum->Bn(), bn);
+    BN_CTX_end(ctx);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Usub)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  BN_copy(res->Bn(), bignum->Bn());
+  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
+    BN_sub_word(res->Bn(), x);
+  } else {
+    AutoBN_CTX ctx;
+    BN_CTX_start(ctx);
+    BIGNUM *bn = BN_CTX_get(ctx);
+    BN_set_u64(bn, x);
+    BN_sub(res->Bn(), bignum->Bn(), bn);
+    BN_CTX_end(ctx);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Umul)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  BN_copy(res->Bn(), bignum->Bn());
+  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
+    BN_mul_word(res->Bn(), x);
+  } else {
+    AutoBN_CTX ctx;
+    BN_CTX_start(ctx);
+    BIGNUM *bn = BN_CTX_get(ctx);
+    BN_set_u64(bn, x);
+    BN_mul(res->Bn(), bignum->Bn(), bn, ctx);
+    BN_CTX_end(ctx);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Udiv)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  BN_copy(res->Bn(), bignum->Bn());
+  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
+    BN_div_word(res->Bn(), x);
+  } else {
+    AutoBN_CTX ctx;
+    BN_CTX_start(ctx);
+    BIGNUM *bn = BN_CTX_get(ctx);
+    BN_set_u64(bn, x);
+    BN_div(res->Bn(), NULL, bignum->Bn(), bn, ctx);
+    BN_CTX_end(ctx);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Umul_2exp)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  int64_t v = bignum->SmallValue();
+  uint64_t m = v < 0 ? 0 - (uint64_t) v : (uint64_t) v;
+  if (bignum->IsSmall() && x < 63 && m <= ((uint64_t) INT64_MAX >> x)) {
+    res->SetSmall(v < 0 ? -(int64_t) (m << x) : (int64_t) (m << x));
+  } else {
+    BN_lshift(res->Bn(), bignum->Bn(), x);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Udiv_2exp)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  if (bignum->IsSmall()) {
+    // BN_rshift shifts the magnitude, so negative values round toward zero
+    int64_t v = bignum->SmallValue();
+    int64_t m = x < 63 ? (v < 0 ? -v : v) >> x : 0;
+    res->SetSmall(v < 0 ? -m : m);
+  } else {
+    BN_rshift(res->Bn(), bignum->Bn(), x);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Babs)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *res = OutArg(info, 0);
+  if (bignum->IsSmall()) {
+    res->SetSmall(bignum->SmallValue() < 0 ? -bignum->SmallValue() : bignum->SmallValue());
+  } else {
+    BN_copy(res->Bn(), bignum->Bn());
+    BN_set_negative(res->Bn(), 0);
+  }
+
+  ReturnResult(info, 0, res);
+}
+
+NAN_METHOD(BigNum::Bneg)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *res = OutArg(info, 0);
+  if (bignum->IsSmall()) {
+    res->SetSmall(-bignum->SmallValue());
+  } else {
+    BN_copy(res->Bn(), bignum->Bn());
+    BN_set_negative(res->Bn(), !BN_is_negative(res->Bn()));
+  }
+
+  ReturnResult(info, 0, res);
+}
+
+NAN_METHOD(BigNum::Bmod)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 1);
+  BN_div(NULL, res->Bn(), bignum->Bn(), bn->Bn(), ctx);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Umod)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BigNum *res = OutArg(info, 1);
+  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
+    BN_set_word(res->Bn(), BN_mod_word(bignum->Bn(), x));
+  } else {
+    AutoBN_CTX ctx;
+    BN_CTX_start(ctx);
+    BIGNUM *bn = BN_CTX_get(ctx);
+    BN_set_u64(bn, x);
+    BN_div(NULL, res->Bn(), bignum->Bn(), bn, ctx);
+    BN_CTX_end(ctx);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bpowm)
 {
   AutoBN_CTX ctx;
   BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
 
-  REQ_UINT32_ARG(0, reps);
+  BigNum *bn1 = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *bn2 = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 2);
+  mod_exp(res->Bn(), bignum->Bn(), bn1->Bn(), bn2, ctx);
+
+  ReturnResult(info, 2, res);
+}
+
+NAN_METHOD(BigNum::Upowm)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BN_CTX_start(ctx);
+  BIGNUM *exp = BN_CTX_get(ctx);
+  BN_set_u64(exp, x);
+
+  BigNum *res = OutArg(info, 2);
+  mod_exp(res->Bn(), bignum->Bn(), exp, bn, ctx);
+  BN_CTX_end(ctx);
+
+  ReturnResult(info, 2, res);
+}
+
+NAN_METHOD(BigNum::Upow)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  BN_CTX_start(ctx);
+  BIGNUM *exp = BN_CTX_get(ctx);
+  BN_set_u64(exp, x);
+
+  BigNum *res = OutArg(info, 1);
+  BN_exp(res->Bn(), bignum->Bn(), exp, ctx);
+  BN_CTX_end(ctx);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Brand0)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *res = new BigNum();
+
+  BN_rand_range(res->Bn(), bignum->Bn());
+
+  WRAP_RESULT(res, result);
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(BigNum::Uprime0)
+{
+  REQ_UINT32_ARG(0, x);
+  REQ_BOOL_ARG(1, safe);
+
+  BigNum *res = new BigNum();
+
+  BN_generate_prime_ex(res->Bn(), x, safe, NULL, NULL, NULL);
+
+  WRAP_RESULT(res, result);
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * OpenSSL's own primality test. OpenSSL 3 picks the round count itself (64,
+ * or 128 above 2048 bits) and would ignore a smaller reps anyway; older
+ * versions run reps rounds. Returns 1 for a probable prime, 0 for a
+ * composite and -1 on error or if cb aborted.
+ */
+static int
+checkPrime(const BIGNUM *n, int reps, BN_CTX *ctx, BN_GENCB *cb)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  (void) reps;
+  return BN_check_prime(n, ctx, cb);
+#else
+  return BN_is_prime_ex(n, reps, ctx, cb);
+#endif
+}
+
+NAN_METHOD(BigNum::Probprime)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, reps);
+
+  info.GetReturnValue().Set(Nan::New<Number>(checkPrime(bignum->Bn(), reps, ctx, NULL)));
+}
+
+// Odd primes below 2^16, for sieving prime candidates.
+static const vector<uint32_t>&
+sievePrimes()
+{
+  static const vector<uint32_t> primes = [] {
+    vector<uint32_t> out;
+    vector<bool> composite(1 << 16, false);
+    for (uint32_t i = 3; i < (1u << 16); i += 2) {
+      if (composite[i]) {
+        continue;
+      }
+      out.push_back(i);
+      for (uint32_t j = i * i; j < (1u << 16); j += 2 * i) {
+        composite[j] = true;
+      }
+    }
+    return out;
+  }();
+  return primes;
+}
+
+// Trial division, exact for n up to 2^32 and a little beyond.
+static bool
+isPrimeWord(uint64_t n)
+{
+  if (n < 2) {
+    return false;
+  }
+  if (n % 2 == 0) {
+    return n == 2;
+  }
+  const vector<uint32_t> &primes = sievePrimes();
+  for (size_t i = 0; i < primes.size() && (uint64_t) primes[i] * primes[i] <= n; i++) {
+    if (n % primes[i] == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Miller-Rabin on odd n > 3: the first round uses base 2, so composites
+ * are usually rejected after one exponentiation, and the rest use random
+ * bases. Returns 1 for a probable prime, 0 for a composite.
+ */
+static int
+millerRabin(const BIGNUM *n, int rounds, BN_CTX *ctx)
+{
+  BN_CTX_start(ctx);
+  BIGNUM *nm1 = BN_CTX_get(ctx);
+  BIGNUM *d = BN_CTX_get(ctx);
+  BIGNUM *a = BN_CTX_get(ctx);
+  BIGNUM *y = BN_CTX_get(ctx);
+  BIGNUM *range = BN_CTX_get(ctx);
+  BN_MONT_CTX *mont = BN_MONT_CTX_new();
+  BN_MONT_CTX_set(mont, n, ctx);
+
+  // n - 1 = d * 2^s with d odd
+  BN_copy(nm1, n);
+  BN_sub_word(nm1, 1);
+  int s = 0;
+  while (!BN_is_bit_set(nm1, s)) {
+    s++;
+  }
+  BN_rshift(d, nm1, s);
+  BN_copy(range, n);
+  BN_sub_word(range, 3);
+
+  int result = 1;
+  for (int i = 0; i < rounds && result; i++) {
+    if (i == 0) {
+      BN_mod_exp_mont_word(y, 2, d, n, ctx, mont);
+    } else {
+      // a in [2, n - 2]
+      BN_priv_rand_range(a, range);
+      BN_add_word(a, 2);
+      BN_mod_exp_mont(y, a, d, n, ctx, mont);
+    }
+    if (BN_is_one(y) || BN_cmp(y, nm1) == 0) {
+      continue;
+    }
+
+    result = 0;
+    for (int j = 1; j < s; j++) {
+      BN_mod_sqr(y, y, n, ctx);
+      if (BN_cmp(y, nm1) == 0) {
+        result = 1;
+        break;
+      }
+      if (BN_is_one(y)) {
+        break;
+      }
+    }
+  }
+
+  BN_MONT_CTX_free(mont);
+  BN_CTX_end(ctx);
+  return result;
+}
+
+/**
+ * r = the nearest probable prime above n (or below it, if down). Word-sized
+ * values are settled by trial division. Larger ones are sieved in windows
+ * of odd candidates against the odd primes below 2^16, with the residues
+ * carried from one window to the next, and only the survivors get
+ * Miller-Rabin. With reps = 0 a survivor that passes a base-2 round is
+ * confirmed by checkPrime() with at least 64 rounds; otherwise reps rounds
+ * decide. cb, if given,
+ * is called before each test and can abort the search by returning 0.
+ * Returns 1 on success, 0 if there is no such prime or the search aborted.
+ */
+static int
+bn_next_prime(BIGNUM *r, const BIGNUM *n, bool down, int reps, BN_CTX *ctx,
+              BN_GENCB *cb)
+{
+  if (BN_num_bits(n) <= 32 || BN_is_negative(n)) {
+    if (BN_is_negative(n)) {
+      if (down) {
+        return 0;
+      }
+      BN_set_word(r, 2);
+      return 1;
+    }
+    uint64_t c = BN_get_word(n);
+    do {
+      if (down && c <= 2) {
+        return 0;
+      }
+      c = down ? c - 1 : c + 1;
+    } while (!isPrimeWord(c));
+    BN_set_u64(r, c);
+    return 1;
+  }
+
+  const vector<uint32_t> &primes = sievePrimes();
+  const uint32_t window = 4096;
+  vector<uint32_t> residues(primes.size());
+  vector<char> sieve(window);
+
+  // The first odd candidate past n; candidate k is base +/- 2k
+  BN_CTX_start(ctx);
+  BIGNUM *base = BN_CTX_get(ctx);
+  BIGNUM *c = BN_CTX_get(ctx);
+  BN_copy(base, n);
+  if (down) {
+    BN_sub_word(base, BN_is_odd(base) ? 2 : 1);
+  } else {
+    BN_add_word(base, BN_is_odd(base) ? 2 : 1);
+  }
+
+  // Residues of base, a word's worth of primes per BN_mod_word
+  for (size_t i = 0; i < primes.size();) {
+    BN_ULONG prod = primes[i];
+    size_t j = i + 1;
+    while (j < primes.size() && prod <= ((BN_ULONG) -1) / primes[j]) {
+      prod *= primes[j++];
+    }
+    BN_ULONG rem = BN_mod_word(base, prod);
+    for (; i < j; i++) {
+      residues[i] = rem % primes[i];
+    }
+  }
+
+  int found = 0, tested = 0;
+  while (!found) {
+    // Candidate k is divisible by p when base +/- 2k == 0 mod p
+    std::fill(sieve.begin(), sieve.end(), 0);
+    for (size_t i = 0; i < primes.size(); i++) {
+      uint64_t p = primes[i];
+      uint64_t r0 = down ? residues[i] : (p - residues[i]) % p;
+      for (uint64_t k = r0 * ((p + 1) / 2) % p; k < window; k += p) {
+        sieve[k] = 1;
+      }
+    }
+
+    for (uint32_t k = 0; k < window && !found; k++) {
+      if (sieve[k]) {
+        continue;
+      }
+      if (cb != NULL && !BN_GENCB_call(cb, 0, tested++)) {
+        BN_CTX_end(ctx);
+        return 0;
+      }
+      BN_copy(c, base);
+      if (down) {
+        BN_sub_word(c, 2 * k);
+      } else {
+        BN_add_word(c, 2 * k);
+      }
+      found = millerRabin(c, reps > 0 ? reps : 1, ctx);
+      if (found && reps <= 0) {
+        found = checkPrime(c, 64, ctx, cb);
+        if (found < 0) {
+          BN_CTX_end(ctx);
+          return 0;
+        }
+      }
+    }
+
+    if (!found) {
+      for (size_t i = 0; i < primes.size(); i++) {
+        uint32_t p = primes[i];
+        uint32_t step = (2 * window) % p;
+        residues[i] = down ? (residues[i] + p - step) % p : (residues[i] + step) % p;
+      }
+      if (down) {
+        BN_sub_word(base, 2 * window);
+      } else {
+        BN_add_word(base, 2 * window);
+      }
+    }
+  }
+
+  BN_copy(r, c);
+  BN_CTX_end(ctx);
+  return 1;
+}
+
+// bnextprime(reps, down)
+NAN_METHOD(BigNum::Bnextprime)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, reps);
+  REQ_BOOL_ARG(1, down);
+
+  AutoBN_CTX ctx;
+  BigNum *res = new BigNum();
+  if (!bn_next_prime(res->Bn(), bignum->Bn(), down, reps, ctx, NULL)) {
+    delete res;
+    Nan::ThrowRangeError("There is no prime below 2");
+    return;
+  }
+
+  info.GetReturnValue().Set(NewInstance(res));
+}
+
+/**
+ * Cancellation flag shared between JS and an async worker. cancel() runs on
+ * the event loop while pool and search threads poll the flag, so it is an
+ * atomic rather than bytes in a Buffer. The worker keeps the JS object alive
+ * until it completes.
+ */
+class CancelToken : public Nan::ObjectWrap {
+public:
+  static void Initialize(Local<Object> target);
+  static const atomic<bool>* Flag(Local<Value> val);
+
+protected:
+  static Nan::Persistent<FunctionTemplate> constructor_template;
+
+  atomic<bool> cancelled_;
+
+  CancelToken() : Nan::ObjectWrap (), cancelled_(false) {}
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Cancel);
+};
+
+Nan::Persistent<FunctionTemplate> CancelToken::constructor_template;
+
+void CancelToken::Initialize(v8::Local<v8::Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
+  constructor_template.Reset(tmpl);
+
+  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tmpl->SetClassName(Nan::New("CancelToken").ToLocalChecked());
+
+  Nan::SetPrototypeMethod(tmpl, "cancel", Cancel);
+
+  Nan::Set(target, Nan::New("CancelToken").ToLocalChecked(), Nan::GetFunction(tmpl).ToLocalChecked());
+}
+
+// The flag of a CancelToken, or NULL if val is not one
+const atomic<bool>* CancelToken::Flag(Local<Value> val)
+{
+  if (!val->IsObject() || !Nan::New(constructor_template)->HasInstance(val)) {
+    return NULL;
+  }
+  return &Nan::ObjectWrap::Unwrap<CancelToken>(val.As<Object>())->cancelled_;
+}
+
+NAN_METHOD(CancelToken::New)
+{
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("CancelToken must be called with new");
+    return;
+  }
+
+  CancelToken *token = new CancelToken();
+  token->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(CancelToken::Cancel)
+{
+  Nan::ObjectWrap::Unwrap<CancelToken>(info.This())->cancelled_.store(true);
+}
+
+/**
+ * Base class for operations that run on the libuv thread pool.
+ *
+ * Operands are copied off the V8 heap on construction, so the worker never
+ * touches a JS object from the pool thread. An optional CancelToken carries
+ * the cancellation flag: JS sets it and OpenSSL's BN_GENCB callback aborts
+ * the search the next time it reports progress.
+ */
+class BigNumWorker : public Nan::AsyncWorker
+{
+public:
+  BigNumWorker(Nan::Callback *callback, Local<Value> token)
+    : Nan::AsyncWorker(callback), res_(NULL), cancelled_(NULL),
+      gencb_(BN_GENCB_new())
+  {
+    cancelled_ = CancelToken::Flag(token);
+    if (cancelled_ != NULL) {
+      SaveToPersistent("token", token);
+    }
+    if (gencb_ != NULL) {
+      BN_GENCB_set(gencb_, Progress, this);
+    }
+  }
+
+  ~BigNumWorker()
+  {
+    BN_GENCB_free(gencb_);
+    delete res_;
+  }
+
+protected:
+  BigNum *res_;
+
+  bool IsCancelled() const { return cancelled_ != NULL && cancelled_->load(); }
+
+  void SetFailure(const char *msg)
+  {
+    SetErrorMessage(IsCancelled() ? "Operation cancelled" : msg);
+  }
+
+  // NULL if it could not be allocated; workers that need it must fail
+  BN_GENCB *GenCb() { return gencb_; }
+
+  void HandleOKCallback()
+  {
+    Nan::HandleScope scope;
+
+    Local<Object> result = BigNum::NewInstance(res_);
+    res_ = NULL;
+
+    Local<Value> argv[2] = { Nan::Null(), result };
+    callback->Call(2, argv, async_resource);
+  }
+
+private:
+  const atomic<bool> *cancelled_;
+  BN_GENCB *gencb_;
+
+  static int Progress(int /* p */, int /* n */, BN_GENCB *cb)
+  {
+    BigNumWorker *worker = static_cast<BigNumWorker*>(BN_GENCB_get_arg(cb));
+    return worker->IsCancelled() ? 0 : 1;
+  }
+};
+
+class PrimeWorker : public BigNumWorker
+{
+public:
+  PrimeWorker(Nan::Callback *callback, Local<Value> token,
+              uint32_t bits, bool safe)
+    : BigNumWorker(callback, token), bits_(bits), safe_(safe)
+  {
+    res_ = new BigNum();
+    res_->Bn(); // allocate now; Execute runs off the JS thread
+  }
+
+  void Execute()
+  {
+    if (GenCb() == NULL) {
+      SetFailure("Out of memory");
+      return;
+    }
+    if (!BN_generate_prime_ex(res_->Bn(), bits_, safe_, NULL, NULL, GenCb())) {
+      SetFailure("Prime generation failed");
+    }
+  }
+
+private:
+  uint32_t bits_;
+  bool safe_;
+};
+
+/**
+ * Candidate counters for a parallel prime search, reported to JS through a
+ * uv_async handle. Search threads only touch the atomics and wake the
+ * handle; libuv coalesces wakeups, so the callback sees the latest totals
+ * at most once per loop iteration. The object frees itself once the handle
+ * has been closed.
+ */
+class PrimeProgress
+{
+public:
+  explicit PrimeProgress(Local<Value> fn)
+    : tested(0), rejected(0), callback_(NULL),
+      resource_("bignum:primeParallel")
+  {
+    if (fn->IsFunction()) {
+      callback_ = new Nan::Callback(fn.As<Function>());
+    }
+    async_.data = this;
+    uv_async_init(Nan::GetCurrentEventLoop(), &async_, Deliver);
+  }
+
+  atomic<uint64_t> tested;
+  atomic<uint64_t> rejected;
+
+  void Send()
+  {
+    if (callback_ != NULL) {
+      uv_async_send(&async_);
+    }
+  }
+
+  // Event loop only: report the final totals and release the handle.
+  void Close()
+  {
+    Report();
+    uv_close(reinterpret_cast<uv_handle_t*>(&async_), Closed);
+  }
+
+private:
+  uv_async_t async_;
+  Nan::Callback *callback_;
+  Nan::AsyncResource resource_;
+
+  ~PrimeProgress()
+  {
+    delete callback_;
+  }
+
+  void Report()
+  {
+    if (callback_ == NULL) {
+      return;
+    }
+    Nan::HandleScope scope;
+
+    Local<Object> counts = Nan::New<Object>();
+    Nan::Set(counts, Nan::New("tested").ToLocalChecked(), Nan::New<Number>((double) tested.load()));
+    Nan::Set(counts, Nan::New("rejected").ToLocalChecked(), Nan::New<Number>((double) rejected.load()));
+
+    Local<Value> argv[1] = { counts };
+    callback_->Call(1, argv, &resource_);
+  }
+
+  static void Deliver(uv_async_t *handle)
+  {
+    static_cast<PrimeProgress*>(handle->data)->Report();
+  }
+
+  static void Closed(uv_handle_t *handle)
+  {
+    delete static_cast<PrimeProgress*>(handle->data);
+  }
+};
+
+// Longest primeParallel timeout, about 31 years; beyond it the deadline
+// would overflow the clock arithmetic
+static const double kPrimeMaxTimeoutMs = 1e12;
+
+/**
+ * Runs independent BN_generate_prime_ex searches on several threads and
+ * keeps the first prime found. The pool thread running Execute() waits for
+ * the searchers and pushes progress to JS; the searchers' BN_GENCB callbacks
+ * abort as soon as one of them has succeeded, the token is set or the
+ * deadline passes. That pool thread is busy for the whole search, which the
+ * README points out.
+ */
+class ParallelPrimeWorker : public BigNumWorker
+{
+public:
+  ParallelPrimeWorker(Nan::Callback *callback, Local<Value> token,
+                      uint32_t bits, bool safe, uint32_t threads,
+                      double timeoutMs, Local<Value> onProgress)
+    : BigNumWorker(callback, token), bits_(bits), safe_(safe),
+      threads_(threads), timed_(false), stop_(false),
+      running_(0), progress_(new PrimeProgress(onProgress))
+  {
+    // More searchers than cores only add contention, and each one is an OS
+    // thread that may fail to start
+    uint32_t cores = max(1u, thread::hardware_concurrency());
+    if (threads_ == 0 || threads_ > cores) {
+      threads_ = cores;
+    }
+    // The deadline counts from the call, not from when a pool thread picks
+    // the job up. NaN, Infinity and anything over kPrimeMaxTimeoutMs mean none.
+    if (timeoutMs > 0 && timeoutMs <= kPrimeMaxTimeoutMs) {
+      timed_ = true;
+      deadline_ = chrono::steady_clock::now() +
+        chrono::microseconds((int64_t) (timeoutMs * 1000));
+    }
+    res_ = new BigNum();
+    res_->Bn(); // allocate now; Execute runs off the JS thread
+  }
+
+  void Execute()
+  {
+    typedef chrono::steady_clock Clock;
+    const chrono::milliseconds tick(50);
+
+    vector<Searcher> searchers(threads_);
+    // libuv reports a thread that cannot start as an error code; node
+    // builds addons without exceptions, so std::thread would abort instead
+    vector<uv_thread_t> pool(threads_);
+    uint32_t started = 0;
+    running_ = threads_;
+    for (; started < threads_; started++) {
+      searchers[started].worker = this;
+      if (uv_thread_create(&pool[started], Search, &searchers[started]) != 0) {
+        // Stop the searchers already running; they are joined below
+        lock_guard<mutex> lock(mutex_);
+        running_ -= threads_ - started;
+        stop_ = true;
+        break;
+      }
+    }
+
+    {
+      unique_lock<mutex> lock(mutex_);
+      while (running_ > 0) {
+        if (IsCancelled() || (timed_ && Clock::now() >= deadline_)) {
+          stop_ = true;
+        }
+        done_.wait_for(lock, tick);
+        progress_->Send();
+      }
+    }
+    for (uint32_t i = 0; i < started; i++) {
+      uv_thread_join(&pool[i]);
+    }
+
+    if (started < threads_) {
+      SetFailure("Could not start prime search threads");
+    } else if (BN_is_zero(res_->Bn())) {
+      bool expired = timed_ && Clock::now() >= deadline_;
+      SetFailure(expired ? "Prime generation timed out" : "Prime generation failed");
+    }
+  }
+
+  void WorkComplete()
+  {
+    progress_->Close();
+    BigNumWorker::WorkComplete();
+  }
+
+private:
+  struct Searcher
+  {
+    Searcher() : worker(NULL), pending(false) {}
+
+    ParallelPrimeWorker *worker;
+    bool pending;
+  };
+
+  uint32_t bits_;
+  bool safe_;
+  uint32_t threads_;
+  bool timed_;
+  chrono::steady_clock::time_point deadline_;
+  atomic<bool> stop_;
+  uint32_t running_;
+  mutex mutex_;
+  condition_variable done_;
+  PrimeProgress *progress_;
+
+  static void Search(void *arg)
+  {
+    Searcher *s = static_cast<Searcher*>(arg);
+    ParallelPrimeWorker *self = s->worker;
+    BIGNUM *p = BN_new();
+    BN_GENCB *cb = BN_GENCB_new();
+    BN_GENCB_set(cb, Candidate, s);
+
+    bool found = p != NULL && cb != NULL &&
+      BN_generate_prime_ex(p, self->bits_, self->safe_, NULL, NULL, cb);
+
+    {
+      lock_guard<mutex> lock(self->mutex_);
+      if (found && !self->stop_) {
+        BN_copy(self->res_->Bn(), p);
+        self->stop_ = true;
+      }
+      self->running_--;
+    }
+    self->done_.notify_one();
+
+    BN_GENCB_free(cb);
+    BN_clear_free(p);
+  }
+
+  // Event 0 announces a candidate that survived trial division; any earlier
+  // candidate from the same thread failed Miller-Rabin.
+  static int Candidate(int event, int /* n */, BN_GENCB *cb)
+  {
+    Searcher *s = static_cast<Searcher*>(BN_GENCB_get_arg(cb));
+    ParallelPrimeWorker *self = s->worker;
+
+    if (event == 0) {
+      self->progress_->tested++;
+      if (s->pending) {
+        self->progress_->rejected++;
+      }
+      s->pending = true;
+    }
+
+    if (self->stop_ || self->IsCancelled()) {
+      return 0;
+    }
+    if (self->timed_ && chrono::steady_clock::now() >= self->deadline_) {
+      return 0;
+    }
+    return 1;
+  }
+};
+
+class ProbprimeWorker : public BigNumWorker
+{
+public:
+  ProbprimeWorker(Nan::Callback *callback, Local<Value> token,
+                  const BIGNUM *num, uint32_t reps)
+    : BigNumWorker(callback, token), num_(BN_dup(num)), reps_(reps),
+      result_(0)
+  {
+  }
+
+  ~ProbprimeWorker()
+  {
+    BN_clear_free(num_);
+  }
+
+  void Execute()
+  {
+    if (GenCb() == NULL) {
+      SetFailure("Out of memory");
+      return;
+    }
+    AutoBN_CTX ctx;
+    result_ = checkPrime(num_, reps_, ctx, GenCb());
+    if (result_ < 0 || IsCancelled()) {
+      SetFailure("Primality test failed");
+    }
+  }
+
+  void HandleOKCallback()
+  {
+    Nan::HandleScope scope;
+
+    Local<Value> argv[2] = { Nan::Null(), Nan::New<Number>(result_) };
+    callback->Call(2, argv, async_resource);
+  }
+
+private:
+  BIGNUM *num_;
+  uint32_t reps_;
+  int result_;
+};
+
+class NextPrimeWorker : public BigNumWorker
+{
+public:
+  NextPrimeWorker(Nan::Callback *callback, Local<Value> token,
+                  const BIGNUM *num, uint32_t reps, bool down)
+    : BigNumWorker(callback, token), num_(BN_dup(num)), reps_(reps),
+      down_(down)
+  {
+    res_ = new BigNum();
+    res_->Bn(); // allocate now; Execute runs off the JS thread
+  }
+
+  ~NextPrimeWorker()
+  {
+    BN_clear_free(num_);
+  }
+
+  void Execute()
+  {
+    if (GenCb() == NULL) {
+      SetFailure("Out of memory");
+      return;
+    }
+    AutoBN_CTX ctx;
+    if (!bn_next_prime(res_->Bn(), num_, down_, reps_, ctx, GenCb())) {
+      SetFailure("There is no prime below 2");
+    }
+  }
+
+private:
+  BIGNUM *num_;
+  uint32_t reps_;
+  bool down_;
+};
+
+class PowmWorker : public BigNumWorker
+{
+public:
+  PowmWorker(Nan::Callback *callback, Local<Value> token,
+             const BIGNUM *base, const BIGNUM *exp, const BIGNUM *mod)
+    : BigNumWorker(callback, token), base_(BN_dup(base)), exp_(BN_dup(exp)),
+      mod_(BN_dup(mod))
+  {
+    res_ = new BigNum();
+    res_->Bn(); // allocate now; Execute runs off the JS thread
+  }
+
+  ~PowmWorker()
+  {
+    BN_clear_free(base_);
+    BN_clear_free(exp_);
+    BN_clear_free(mod_);
+  }
+
+  void Execute()
+  {
+    AutoBN_CTX ctx;
+    if (IsCancelled() || !BN_mod_exp(res_->Bn(), base_, exp_, mod_, ctx)) {
+      SetFailure("Modular exponentiation failed");
+    }
+  }
+
+private:
+  BIGNUM *base_;
+  BIGNUM *exp_;
+  BIGNUM *mod_;
+};
+
+NAN_METHOD(BigNum::Uprime0Async)
+{
+  REQ_UINT32_ARG(0, x);
+  REQ_BOOL_ARG(1, safe);
+  REQ_FUN_ARG(3, cb);
+
+  Nan::AsyncQueueWorker(new PrimeWorker(new Nan::Callback(cb), info[2], x, safe));
+}
+
+// uprimeParallel(bits, safe, threads, timeoutMs, token, onProgress, cb)
+NAN_METHOD(BigNum::UprimeParallel)
+{
+  REQ_UINT32_ARG(0, bits);
+  REQ_BOOL_ARG(1, safe);
+  REQ_UINT32_ARG(2, threads);
+  REQ_FUN_ARG(6, cb);
+
+  double timeoutMs = Nan::To<double>(info[3]).FromJust();
+
+  Nan::AsyncQueueWorker(new ParallelPrimeWorker(new Nan::Callback(cb), info[4], bits, safe, threads, timeoutMs, info[5]));
+}
+
+NAN_METHOD(BigNum::ProbprimeAsync)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, reps);
+  REQ_FUN_ARG(2, cb);
+
+  Nan::AsyncQueueWorker(new ProbprimeWorker(new Nan::Callback(cb), info[1], bignum->Bn(), reps));
+}
+
+// bnextprimeAsync(reps, down, token, cb)
+NAN_METHOD(BigNum::BnextprimeAsync)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, reps);
+  REQ_BOOL_ARG(1, down);
+  REQ_FUN_ARG(3, cb);
+
+  Nan::AsyncQueueWorker(new NextPrimeWorker(new Nan::Callback(cb), info[2], bignum->Bn(), reps, down));
+}
+
+NAN_METHOD(BigNum::BpowmAsync)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn1 = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *bn2 = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  REQ_FUN_ARG(3, cb);
+
+  Nan::AsyncQueueWorker(new PowmWorker(new Nan::Callback(cb), info[2], bignum->Bn(), bn1->Bn(), bn2->Bn()));
+}
+
+NAN_METHOD(BigNum::CtxPoolStats)
+{
+  BN_CTX_Pool &pool = BN_CTX_Pool::Current();
+
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("created").ToLocalChecked(), Nan::New<Number>(pool.created));
+  Nan::Set(result, Nan::New("acquired").ToLocalChecked(), Nan::New<Number>(pool.acquired));
+  Nan::Set(result, Nan::New("inUse").ToLocalChecked(), Nan::New<Number>(pool.inUse));
+  Nan::Set(result, Nan::New("pooled").ToLocalChecked(), Nan::New<Number>(pool.Pooled()));
+  Nan::Set(result, Nan::New("highWater").ToLocalChecked(), Nan::New<Number>(pool.highWater));
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(BigNum::MemoryUsage)
+{
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("objects").ToLocalChecked(), Nan::New<Number>((double) liveObjects.load()));
+  Nan::Set(result, Nan::New("bytes").ToLocalChecked(), Nan::New<Number>((double) nativeBytes.load()));
+  Nan::Set(result, Nan::New("created").ToLocalChecked(), Nan::New<Number>((double) createdObjects.load()));
+
+  info.GetReturnValue().Set(result);
+}
+
+// enableStats(on=true)
+NAN_METHOD(BigNum::EnableStats)
+{
+  MethodStats::enabled.store(info.Length() < 1 || info[0]->IsUndefined() || Nan::To<bool>(info[0]).FromJust());
+}
+
+NAN_METHOD(BigNum::Stats)
+{
+  Local<Object> methods = Nan::New<Object>();
+  lock_guard<mutex> lock(MethodStats::Lock());
+  vector<MethodStats::Entry*> &entries = MethodStats::All();
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    MethodStats::Entry *e = entries[i];
+    uint64_t calls = e->calls.load(memory_order_relaxed);
+    if (calls == 0) {
+      continue;
+    }
+
+    uint64_t counts[MethodStats::kBuckets];
+    int top = 0;
+    for (int k = 0; k < MethodStats::kBuckets; k++) {
+      counts[k] = e->bits[k].load(memory_order_relaxed);
+      if (counts[k] != 0) {
+        top = k + 1;
+      }
+    }
+    Local<Array> bits = Nan::New<Array>(top);
+    for (int k = 0; k < top; k++) {
+      Nan::Set(bits, k, Nan::New<Number>((double) counts[k]));
+    }
+
+    Local<Object> entry = Nan::New<Object>();
+    Nan::Set(entry, Nan::New("calls").ToLocalChecked(), Nan::New<Number>((double) calls));
+    Nan::Set(entry, Nan::New("timeNs").ToLocalChecked(), Nan::New<Number>((double) e->ns.load(memory_order_relaxed)));
+    Nan::Set(entry, Nan::New("bits").ToLocalChecked(), bits);
+    Nan::Set(methods, Nan::New(e->name).ToLocalChecked(), entry);
+  }
+
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("enabled").ToLocalChecked(), Nan::New<Boolean>(MethodStats::enabled.load()));
+  Nan::Set(result, Nan::New("methods").ToLocalChecked(), methods);
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(BigNum::ResetStats)
+{
+  lock_guard<mutex> lock(MethodStats::Lock());
+  vector<MethodStats::Entry*> &entries = MethodStats::All();
+  for (size_t i = 0; i < entries.size(); i++) {
+    MethodStats::Clear(entries[i]);
+  }
+}
+
+NAN_METHOD(BigNum::IsBitSet)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, n);
+
+  info.GetReturnValue().Set(Nan::New<Number>(BN_is_bit_set(bignum->Bn(), n)));
+}
+
+NAN_METHOD(BigNum::Bcompare)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+
+  info.GetReturnValue().Set(Nan::New<Number>(BN_cmp(bignum->Bn(), bn->Bn())));
+}
+
+NAN_METHOD(BigNum::Scompare)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_INT64_ARG(0, x);
+  AutoBN_CTX ctx;
+  BN_CTX_start(ctx);
+  BIGNUM *bn = BN_CTX_get(ctx);
+  BN_set_u64(bn, x < 0 ? 0 - (uint64_t) x : (uint64_t) x);
+  BN_set_negative(bn, x < 0);
+  int res = BN_cmp(bignum->Bn(), bn);
+  BN_CTX_end(ctx);
+
+  info.GetReturnValue().Set(Nan::New<Number>(res));
+}
+
+NAN_METHOD(BigNum::Ucompare)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT64_ARG(0, x);
+  int res;
+  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
+    BIGNUM* bn = BN_new();
+    BN_set_word(bn, x);
+    res = BN_cmp(bignum->Bn(), bn);
+    BN_clear_free(bn);
+  } else {
+    AutoBN_CTX ctx;
+    BN_CTX_start(ctx);
+    BIGNUM *bn = BN_CTX_get(ctx);
+    BN_set_u64(bn, x);
+    res = BN_cmp(bignum->Bn(), bn);
+    BN_CTX_end(ctx);
+  }
+
+  info.GetReturnValue().Set(Nan::New<Number>(res));
+}
+
+enum ArithOp { ARITH_ADD, ARITH_SUB, ARITH_MUL, ARITH_DIV, ARITH_MOD };
+
+/**
+ * The right-hand side of add/sub/mul/div/mod/cmp. Numbers whose truncated
+ * magnitude fits a BN_ULONG, and BigNums holding such a value inline, are
+ * kept as a sign and a word, so the BN_*_word functions and the inline
+ * paths apply; anything else ends up as a BIGNUM. Strings and BigInts go
+ * through the constructor, which keeps the converted BigNum alive in the
+ * caller's handle scope.
+ */
+class ArithOperand
+{
+public:
+  ArithOperand() : bn(NULL), neg(false), word(0), number(false), owned_(NULL) {}
+
+  ~ArithOperand()
+  {
+    if (owned_ != NULL) {
+      BN_clear_free(owned_);
+    }
+  }
+
+  // Returns false after throwing if v cannot be used as an operand. With a
+  // method name, only numbers, strings and BigInts are converted and other
+  // types are a TypeError; without one, anything goes to the constructor.
+  bool Set(Local<Value> v, const char *method)
+  {
+    if (BigNum::HasInstance(v)) {
+      BigNum *x = Nan::ObjectWrap::Unwrap<BigNum>(v.As<Object>());
+      int64_t s = x->SmallValue();
+      if (x->IsSmall() && (sizeof(BN_ULONG) >= 8 || (s >= -0xFFFFFFFFLL && s <= 0xFFFFFFFFLL))) {
+        neg = s < 0;
+        word = neg ? 0 - (uint64_t) s : (uint64_t) s;
+      } else {
+        bn = x->Bn();
+      }
+      return true;
+    }
+
+    number = v->IsNumber();
+    if (v->IsInt32()) {
+      int32_t x = v.As<Int32>()->Value();
+      neg = x < 0;
+      word = neg ? 0 - (uint64_t) (int64_t) x : (uint64_t) x;
+      return true;
+    }
+    if (v->IsNumber()) {
+      double x = std::trunc(v.As<Number>()->Value());
+      if (std::fabs(x) < std::ldexp(1.0, BN_BITS2)) {
+        neg = x < 0;
+        word = (uint64_t) std::fabs(x);
+      } else {
+        owned_ = BN_new();
+        BN_set_double(owned_, x);
+        bn = owned_;
+      }
+      return true;
+    }
+
+    if (method != NULL && !v->IsString()
+#ifdef BIGNUM_HAVE_BIGINT
+        && !v->IsBigInt()
+#endif
+        ) {
+      Nan::ThrowTypeError((string("Unspecified operation for type ") +
+        *Nan::Utf8String(v->TypeOf(v8::Isolate::GetCurrent())) + " for " + method).c_str());
+      return false;
+    }
+
+    Local<Object> obj;
+    if (!BigNum::Convert(v).ToLocal(&obj)) {
+      return false;
+    }
+    bn = Nan::ObjectWrap::Unwrap<BigNum>(obj)->Bn();
+    return true;
+  }
+
+  // Compares a with the word operand.
+  int CompareWord(const BIGNUM *a) const
+  {
+    int sa = BN_is_zero(a) ? 0 : BN_is_negative(a) ? -1 : 1;
+    int sb = word == 0 ? 0 : neg ? -1 : 1;
+    if (sa != sb) {
+      return sa < sb ? -1 : 1;
+    }
+    if (sa == 0 || BN_num_bits(a) > BN_BITS2) {
+      return sa;
+    }
+    BN_ULONG x = BN_get_word(a);
+    return x > word ? sa : x < word ? -sa : 0;
+  }
+
+  // Compares an inline small value with the word operand.
+  int CompareSmall(int64_t a) const
+  {
+    if (word > (uint64_t) INT64_MAX) {
+      return neg ? 1 : -1;
+    }
+    int64_t v = neg ? -(int64_t) word : (int64_t) word;
+    return a < v ? -1 : a > v ? 1 : 0;
+  }
+
+  const BIGNUM *bn; // NULL when the operand is a word
+  bool neg;
+  uint64_t word;
+  bool number;      // a JS number rather than a BigNum
+
+private:
+  BIGNUM *owned_;
+};
+
+/**
+ * r = a op b on inline small values. Returns false if the result would not
+ * fit, in which case the caller redoes it on BIGNUMs. Neither operand may
+ * be INT64_MIN, which FitsSmall() rules out, so negations are safe.
+ */
+static bool
+smallArith(int op, int64_t a, int64_t b, bool unsignedMod, int64_t *r)
+{
+  uint64_t ma = a < 0 ? 0 - (uint64_t) a : (uint64_t) a;
+  uint64_t mb = b < 0 ? 0 - (uint64_t) b : (uint64_t) b;
+
+  switch (op) {
+  case ARITH_ADD:
+    if (b > 0 ? a > INT64_MAX - b : a < -INT64_MAX - b) {
+      return false;
+    }
+    *r = a + b;
+    return true;
+  case ARITH_SUB:
+    if (b < 0 ? a > INT64_MAX + b : a < -INT64_MAX + b) {
+      return false;
+    }
+    *r = a - b;
+    return true;
+  case ARITH_MUL:
+    if (ma != 0 && mb > (uint64_t) INT64_MAX / ma) {
+      return false;
+    }
+    *r = (int64_t) (ma * mb);
+    if ((a < 0) != (b < 0)) {
+      *r = -*r;
+    }
+    return true;
+  case ARITH_DIV:
+    *r = a / b;
+    return true;
+  case ARITH_MOD:
+    *r = unsignedMod ? (int64_t) (ma % mb) : a % b;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * add/sub/mul/div/mod(n) and the in-place iadd/isub/...(n[, out]), which
+ * write into out or, without one, into the receiver. Type checks are a
+ * single FunctionTemplate::HasInstance and small numbers never become
+ * BIGNUMs, so x.add(1) is one native call. Signs follow BN_div: quotients
+ * truncate, and a remainder takes the dividend's sign, except that mod by a
+ * non-negative number gives |x| mod n as umod always has.
+ */
+void
+BigNum::Arith(Nan::NAN_METHOD_ARGS_TYPE info, int op, bool inPlace)
+{
+  static const char *names[] = { "add", "sub", "mul", "div", "mod" };
+
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  ArithOperand b;
+  if (!b.Set(info[0], names[op])) {
+    return;
+  }
+
+  if ((op == ARITH_DIV || op == ARITH_MOD) &&
+      (b.bn != NULL ? BN_is_zero(b.bn) : b.word == 0)) {
+    Nan::ThrowRangeError("Division by zero");
+    return;
+  }
+
+  Local<Value> target = info.This();
+  BigNum *res = bignum;
+  if (inPlace) {
+    if (info.Length() > 1 && HasInstance(info[1])) {
+      target = info[1];
+      res = Nan::ObjectWrap::Unwrap<BigNum>(info[1].As<Object>());
+    }
+  } else {
+    res = new BigNum();
+  }
+
+  int64_t small;
+  if (bignum->IsSmall() && b.bn == NULL && b.word <= (uint64_t) INT64_MAX &&
+      smallArith(op, bignum->SmallValue(), b.neg ? -(int64_t) b.word : (int64_t) b.word,
+                 b.number && !b.neg, &small)) {
+    res->SetSmall(small);
+  } else if (b.bn != NULL) {
+    const BIGNUM *a = bignum->Bn();
+    BIGNUM *r = res->Bn();
+    AutoBN_CTX ctx;
+    switch (op) {
+    case ARITH_ADD:
+      BN_add(r, a, b.bn);
+      break;
+    case ARITH_SUB:
+      BN_sub(r, a, b.bn);
+      break;
+    case ARITH_MUL:
+      BN_mul(r, a, b.bn, ctx);
+      break;
+    case ARITH_DIV:
+      BN_div(r, NULL, a, b.bn, ctx);
+      break;
+    case ARITH_MOD:
+      BN_div(NULL, r, a, b.bn, ctx);
+      break;
+    }
+  } else {
+    const BIGNUM *a = bignum->Bn();
+    BIGNUM *r = res->Bn();
+    BN_ULONG w = (BN_ULONG) b.word;
+    bool aneg = BN_is_negative(a);
+    switch (op) {
+    case ARITH_ADD:
+    case ARITH_SUB:
+      BN_copy(r, a);
+      if (b.neg == (op == ARITH_ADD)) {
+        BN_sub_word(r, w);
+      } else {
+        BN_add_word(r, w);
+      }
+      break;
+    case ARITH_MUL:
+      BN_copy(r, a);
+      BN_mul_word(r, w);
+      BN_set_negative(r, aneg != b.neg);
+      break;
+    case ARITH_DIV:
+      BN_copy(r, a);
+      BN_div_word(r, w);
+      BN_set_negative(r, aneg != b.neg);
+      break;
+    case ARITH_MOD:
+      // mod by a non-negative number is unsigned, as umod always was
+      BN_set_word(r, BN_mod_word(a, w));
+      BN_set_negative(r, aneg && (b.neg || !b.number));
+      break;
+    }
+  }
+
+  if (inPlace) {
+    res->InvalidateCache();
+    res->TrackMemory();
+    info.GetReturnValue().Set(target);
+  } else {
+    info.GetReturnValue().Set(NewInstance(res));
+  }
+}
+
+NAN_METHOD(BigNum::Add) { Arith(info, ARITH_ADD, false); }
+NAN_METHOD(BigNum::Sub) { Arith(info, ARITH_SUB, false); }
+NAN_METHOD(BigNum::Mul) { Arith(info, ARITH_MUL, false); }
+NAN_METHOD(BigNum::Div) { Arith(info, ARITH_DIV, false); }
+NAN_METHOD(BigNum::Mod) { Arith(info, ARITH_MOD, false); }
+NAN_METHOD(BigNum::Iadd) { Arith(info, ARITH_ADD, true); }
+NAN_METHOD(BigNum::Isub) { Arith(info, ARITH_SUB, true); }
+NAN_METHOD(BigNum::Imul) { Arith(info, ARITH_MUL, true); }
+NAN_METHOD(BigNum::Idiv) { Arith(info, ARITH_DIV, true); }
+NAN_METHOD(BigNum::Imod) { Arith(info, ARITH_MOD, true); }
+
+// cmp(n): -1, 0 or 1. Operands other than BigNums and numbers are converted
+// by the constructor, as BigNum(n) would.
+NAN_METHOD(BigNum::Cmp)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  ArithOperand b;
+  if (!b.Set(info[0], NULL)) {
+    return;
+  }
+
+  int res;
+  if (b.bn != NULL) {
+    res = BN_cmp(bignum->Bn(), b.bn);
+  } else if (bignum->IsSmall()) {
+    res = b.CompareSmall(bignum->SmallValue());
+  } else {
+    res = b.CompareWord(bignum->Bn());
+  }
+  info.GetReturnValue().Set(Nan::New<Int32>(res));
+}
+
+// Bitwise operations act on two's complement limbs, as if every value were
+// sign-extended to infinitely many bits (the semantics of JS's & | ^ ~).
+
+/**
+ * OpenSSL keeps its limb accessors out of the public headers, but Node
+ * exports them along with the rest of its bundled OpenSSL. The prototypes
+ * below are an ABI assumption, see BIGNUM_HAVE_BN_INTERNALS. When they can be
+ * found, limbs are copied straight out of and into BIGNUMs; otherwise the
+ * public BN_bn2lebinpad/BN_lebin2bn are used, which are constant-time and
+ * go byte by byte, so they dominate the cost of a bitwise operation.
+ */
+class LimbAccess
+{
+public:
+  const BN_ULONG* (*getWords)(const BIGNUM *a);
+  int (*getTop)(const BIGNUM *a);
+  int (*setWords)(BIGNUM *a, const BN_ULONG *words, int numWords);
+
+  static const LimbAccess& Get()
+  {
+    static LimbAccess access;
+    return access;
+  }
+
+  bool Available() const
+  {
+    return getWords != NULL && getTop != NULL && setWords != NULL;
+  }
+
+private:
+  LimbAccess() : getWords(NULL), getTop(NULL), setWords(NULL)
+  {
+#ifdef BIGNUM_HAVE_BN_INTERNALS
+    getWords = (const BN_ULONG* (*)(const BIGNUM*)) dlsym(RTLD_DEFAULT, "bn_get_words");
+    getTop = (int (*)(const BIGNUM*)) dlsym(RTLD_DEFAULT, "bn_get_top");
+    setWords = (int (*)(BIGNUM*, const BN_ULONG*, int)) dlsym(RTLD_DEFAULT, "bn_set_words");
+#endif
+  }
+};
+
+static inline bool
+hostIsLittleEndian()
+{
+  const uint16_t one = 1;
+  return *(const uint8_t *) &one == 1;
+}
+
+// BN_bn2lebinpad/BN_lebin2bn speak little endian bytes; on big endian hosts
+// each limb needs its bytes reversed to be usable as a BN_ULONG.
+static void
+swapLimbBytes(BN_ULONG *limbs, size_t n)
+{
+  if (hostIsLittleEndian()) {
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint8_t *b = (uint8_t *) &limbs[i];
+    std::reverse(b, b + sizeof(BN_ULONG));
+  }
+}
+
+static void
+negateLimbs(BN_ULONG *limbs, size_t n)
+{
+  BN_ULONG carry = 1;
+  for (size_t i = 0; i < n; i++) {
+    BN_ULONG v = ~limbs[i] + carry;
+    carry = carry & (v == 0);
+    limbs[i] = v;
+  }
+}
+
+// Writes |bn| into n limbs, zero-extended; n must be at least bn's limb count.
+static void
+loadMagnitude(BN_ULONG *limbs, size_t n, const BIGNUM *bn)
+{
+  const LimbAccess &la = LimbAccess::Get();
+  if (la.Available()) {
+    size_t top = la.getTop(bn);
+    memcpy(limbs, la.getWords(bn), top * sizeof(BN_ULONG));
+    memset(limbs + top, 0, (n - top) * sizeof(BN_ULONG));
+  } else {
+    BN_bn2lebinpad(bn, (unsigned char *) limbs, n * sizeof(BN_ULONG));
+    swapLimbBytes(limbs, n);
+  }
+}
+
+// Writes bn into n limbs in two's complement; n must leave room for the sign.
+static void
+loadTwosComplement(BN_ULONG *limbs, size_t n, const BIGNUM *bn)
+{
+  loadMagnitude(limbs, n, bn);
+  if (BN_is_negative(bn)) {
+    negateLimbs(limbs, n);
+  }
+}
+
+// Reads n limbs into bn as a non-negative value. The limbs are clobbered.
+static void
+storeMagnitude(BIGNUM *bn, BN_ULONG *limbs, size_t n)
+{
+  const LimbAccess &la = LimbAccess::Get();
+  if (la.Available()) {
+    la.setWords(bn, limbs, n);
+  } else {
+    swapLimbBytes(limbs, n);
+    BN_lebin2bn((unsigned char *) limbs, n * sizeof(BN_ULONG), bn);
+  }
+}
+
+// Reads n two's complement limbs into bn. The limbs are clobbered.
+static void
+storeTwosComplement(BIGNUM *bn, BN_ULONG *limbs, size_t n)
+{
+  bool neg = (limbs[n - 1] >> (BN_BITS2 - 1)) != 0;
+  if (neg) {
+    negateLimbs(limbs, n);
+  }
+
+  storeMagnitude(bn, limbs, n);
+  BN_set_negative(bn, neg);
+}
+
+static unsigned int
+popcountLimb(BN_ULONG v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return sizeof(BN_ULONG) > 4 ? __builtin_popcountll(v) : __builtin_popcount(v);
+#else
+  unsigned int c = 0;
+  for (; v; c++) {
+    v &= v - 1;
+  }
+  return c;
+#endif
+}
+
+enum BitOp { BIT_AND, BIT_OR, BIT_XOR, BIT_ANDNOT };
+
+// r = a op b. r may alias a or b.
+static void
+bitOp(BIGNUM *r, const BIGNUM *a, const BIGNUM *b, BitOp op)
+{
+  // One spare limb beyond the longer operand always holds the sign
+  size_t n = max(BN_num_bytes(a), BN_num_bytes(b)) / sizeof(BN_ULONG) + 1;
+
+  static thread_local vector<BN_ULONG> scratch;
+  if (scratch.size() < 2 * n) {
+    scratch.resize(2 * n);
+  }
+  BN_ULONG *x = &scratch[0];
+  BN_ULONG *y = &scratch[n];
+  loadTwosComplement(x, n, a);
+  loadTwosComplement(y, n, b);
+
+  switch (op) {
+  case BIT_AND:
+    for (size_t i = 0; i < n; i++) x[i] &= y[i];
+    break;
+  case BIT_OR:
+    for (size_t i = 0; i < n; i++) x[i] |= y[i];
+    break;
+  case BIT_XOR:
+    for (size_t i = 0; i < n; i++) x[i] ^= y[i];
+    break;
+  case BIT_ANDNOT:
+    for (size_t i = 0; i < n; i++) x[i] &= ~y[i];
+    break;
+  }
+
+  storeTwosComplement(r, x, n);
+}
+
+void
+BigNum::Bop(Nan::NAN_METHOD_ARGS_TYPE info, int op)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 1);
+
+  bitOp(res->Bn(), bignum->Bn(), bn->Bn(), (BitOp) op);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Band)
+{
+  Bop(info, BIT_AND);
+}
+
+NAN_METHOD(BigNum::Bor)
+{
+  Bop(info, BIT_OR);
+}
+
+NAN_METHOD(BigNum::Bxor)
+{
+  Bop(info, BIT_XOR);
+}
+
+NAN_METHOD(BigNum::Bandnot)
+{
+  Bop(info, BIT_ANDNOT);
+}
+
+NAN_METHOD(BigNum::Bnot)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *res = OutArg(info, 0);
+
+  // ~x == -x - 1
+  BN_copy(res->Bn(), bignum->Bn());
+  BN_set_negative(res->Bn(), !BN_is_negative(res->Bn()));
+  BN_sub_word(res->Bn(), 1);
+
+  ReturnResult(info, 0, res);
+}
+
+// Sets or clears bit n in two's complement.
+static void
+changeBit(BIGNUM *r, const BIGNUM *a, int n, bool set)
+{
+  BN_copy(r, a);
+  if (!BN_is_negative(r)) {
+    if (set) {
+      BN_set_bit(r, n);
+    } else if (n < BN_num_bits(r)) {
+      BN_clear_bit(r, n);
+    }
+    return;
+  }
+
+  BIGNUM *mask = BN_new();
+  BN_set_bit(mask, n);
+  bitOp(r, r, mask, set ? BIT_OR : BIT_ANDNOT);
+  BN_free(mask);
+}
+
+NAN_METHOD(BigNum::Bsetbit)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, n);
+  BigNum *res = OutArg(info, 1);
+
+  changeBit(res->Bn(), bignum->Bn(), n, true);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bclearbit)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, n);
+  BigNum *res = OutArg(info, 1);
+
+  changeBit(res->Bn(), bignum->Bn(), n, false);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bmaskbits)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, n);
+  BigNum *res = OutArg(info, 1);
+
+  // The low n bits of the two's complement form, which is never negative:
+  // for x < 0 that is 2^n - (|x| mod 2^n), or 0.
+  bool neg = BN_is_negative(bignum->Bn());
+  BN_copy(res->Bn(), bignum->Bn());
+  BN_set_negative(res->Bn(), 0);
+  if ((int) n < BN_num_bits(res->Bn())) {
+    BN_mask_bits(res->Bn(), n);
+  }
+  if (neg && !BN_is_zero(res->Bn())) {
+    BIGNUM *pow2 = BN_new();
+    BN_set_bit(pow2, n);
+    BN_sub(res->Bn(), pow2, res->Bn());
+    BN_free(pow2);
+  }
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bpopcount)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  size_t n = BN_num_bytes(bignum->Bn()) / sizeof(BN_ULONG) + 1;
+  static thread_local vector<BN_ULONG> scratch;
+  if (scratch.size() < n) {
+    scratch.resize(n);
+  }
+  loadMagnitude(&scratch[0], n, bignum->Bn());
+
+  double count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += popcountLimb(scratch[i]);
+  }
+
+  info.GetReturnValue().Set(Nan::New<Number>(count));
+}
+
+#ifdef BIGNUM_HAVE_BIGINT
+/**
+ * BigInt exposes its magnitude as 64-bit words, least significant first. With
+ * 64-bit limbs these are the BIGNUM limbs themselves; with 32-bit limbs each
+ * word is a pair of them.
+ */
+static const size_t kLimbsPerWord = sizeof(uint64_t) / sizeof(BN_ULONG);
+
+static void
+BN_from_bigint(BIGNUM *bn, Local<BigInt> value)
+{
+  int sign = 0;
+  int count = value->WordCount();
+  static thread_local vector<uint64_t> words;
+  static thread_local vector<BN_ULONG> limbs;
+  words.resize(count + 1);
+  limbs.resize((count + 1) * kLimbsPerWord);
+
+  value->ToWordsArray(&sign, &count, &words[0]);
+  for (int i = 0; i < count; i++) {
+    for (size_t j = 0; j < kLimbsPerWord; j++) {
+      limbs[i * kLimbsPerWord + j] = (BN_ULONG) (words[i] >> (j * BN_BITS2 % 64));
+    }
+  }
+
+  storeMagnitude(bn, &limbs[0], count * kLimbsPerWord);
+  BN_set_negative(bn, sign);
+}
+
+static MaybeLocal<BigInt>
+BN_to_bigint(const BIGNUM *bn)
+{
+  size_t count = (BN_num_bits(bn) + 63) / 64;
+  static thread_local vector<uint64_t> words;
+  static thread_local vector<BN_ULONG> limbs;
+  words.resize(count + 1);
+  limbs.resize((count + 1) * kLimbsPerWord);
+
+  loadMagnitude(&limbs[0], count * kLimbsPerWord, bn);
+  for (size_t i = 0; i < count; i++) {
+    uint64_t w = 0;
+    for (size_t j = 0; j < kLimbsPerWord; j++) {
+      w |= (uint64_t) limbs[i * kLimbsPerWord + j] << (j * BN_BITS2 % 64);
+    }
+    words[i] = w;
+  }
+
+  return BigInt::NewFromWords(Nan::GetCurrentContext(), BN_is_negative(bn), count, &words[0]);
+}
+#endif
+
+// bfrombigint(value)
+NAN_METHOD(BigNum::Bfrombigint)
+{
+#ifdef BIGNUM_HAVE_BIGINT
+  if (info.Length() < 1 || !info[0]->IsBigInt()) {
+    Nan::ThrowTypeError("Argument 0 must be a BigInt");
+    return;
+  }
+
+  BigNum *res = new BigNum();
+  BN_from_bigint(res->Bn(), info[0].As<BigInt>());
+
+  info.GetReturnValue().Set(NewInstance(res));
+#else
+  Nan::ThrowError("BigInt is not supported by this version of Node");
+#endif
+}
+
+NAN_METHOD(BigNum::Btobigint)
+{
+#ifdef BIGNUM_HAVE_BIGINT
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  Local<BigInt> result;
+  if (BN_to_bigint(bignum->Bn()).ToLocal(&result)) {
+    info.GetReturnValue().Set(result);
+  }
+#else
+  Nan::ThrowError("BigInt is not supported by this version of Node");
+#endif
+}
+
+NAN_METHOD(BigNum::Binvertm)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = new BigNum();
+  BN_mod_inverse(res->Bn(), bignum->Bn(), bn->Bn(), ctx);
+
+  WRAP_RESULT(res, result);
+
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * r = floor(a^(1/k)) for a >= 0 and k >= 1, by Newton's iteration
+ *   x' = ((k - 1) x + a / x^(k - 1)) / k
+ * which decreases monotonically to the root from any start at or above it.
+ * The start is estimated in double precision, so only a handful of steps
+ * are needed whatever the size of a or k.
+ */
+static void
+bn_iroot(BIGNUM *r, const BIGNUM *a, unsigned int k, BN_CTX *ctx)
+{
+  int bits = BN_num_bits(a);
+  if (k == 1 || bits <= 1) {
+    BN_copy(r, a);
+    return;
+  }
+  if ((unsigned int) bits <= k) {
+    BN_one(r);
+    return;
+  }
+
+  BN_CTX_start(ctx);
+  BIGNUM *x = BN_CTX_get(ctx);
+  BIGNUM *y = BN_CTX_get(ctx);
+  BIGNUM *t = BN_CTX_get(ctx);
+  BIGNUM *km1 = BN_CTX_get(ctx);
+
+  // The root is 2^(q + f) with q integer, f from the top 64 bits of a in
+  // double precision. Splitting off q keeps f small enough to be accurate
+  // to about 2^-46, and the start is scaled up past that error so it is not
+  // below the root. It is built as mant * 2^shift with mant < 2^BN_BITS2.
+  const int mantBits = BN_BITS2 - 12;
+  int drop = bits > 64 ? bits - 64 : 0;
+  BN_rshift(t, a, drop);
+  int q = drop / k;
+  double f = (log2(BN_get_double(t)) + drop % k) / k;
+  int shift = max(0, q + (int) floor(f) - mantBits);
+  double mant = exp2((q - shift) + f) * (1 + ldexp(1.0, 12 - mantBits));
+  BN_set_word(x, (BN_ULONG) mant + 2);
+  BN_lshift(x, x, shift);
+
+  BN_set_word(km1, k - 1);
+  for (;;) {
+    if (k == 2) {
+      BN_div(y, NULL, a, x, ctx);
+      BN_add(y, y, x);
+      BN_rshift1(y, y);
+    } else {
+      BN_exp(t, x, km1, ctx);
+      BN_div(y, NULL, a, t, ctx);
+      BN_copy(t, x);
+      BN_mul_word(t, k - 1);
+      BN_add(y, y, t);
+      BN_div_word(y, k);
+    }
+    if (BN_cmp(y, x) >= 0) {
+      break;
+    }
+    BN_copy(x, y);
+  }
+
+  BN_copy(r, x);
+  BN_CTX_end(ctx);
+}
+
+// Checks whether a == b^k for some b and k >= 2, with GMP's conventions:
+// 0, 1 and -1 are perfect powers, and negative values need an odd k.
+static bool
+bn_is_perfect_power(const BIGNUM *a, BN_CTX *ctx)
+{
+  if (BN_num_bits(a) <= 1) {
+    return true;
+  }
+
+  BN_CTX_start(ctx);
+  BIGNUM *mag = BN_CTX_get(ctx);
+  BIGNUM *r = BN_CTX_get(ctx);
+  BIGNUM *p = BN_CTX_get(ctx);
+  BIGNUM *e = BN_CTX_get(ctx);
+  BN_copy(mag, a);
+  BN_set_negative(mag, 0);
+
+  // The exponent must divide the number of trailing zero bits
+  int zeros = 0;
+  while (!BN_is_bit_set(mag, zeros)) {
+    zeros++;
+  }
+
+  // Trying prime exponents suffices, as b^(mn) == (b^m)^n
+  bool found = false;
+  int bits = BN_num_bits(mag);
+  for (int k = 2; k < bits && !found; k++) {
+    bool prime = true;
+    for (int d = 2; d * d <= k; d++) {
+      if (k % d == 0) {
+        prime = false;
+        break;
+      }
+    }
+    if (!prime || (zeros > 0 && zeros % k != 0) ||
+        (k == 2 && BN_is_negative(a))) {
+      continue;
+    }
+    bn_iroot(r, mag, k, ctx);
+    BN_set_word(e, k);
+    BN_exp(p, r, e, ctx);
+    found = BN_cmp(p, mag) == 0;
+  }
+
+  BN_CTX_end(ctx);
+  return found;
+}
+
+NAN_METHOD(BigNum::Bsqrt)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  if (BN_is_negative(bignum->Bn())) {
+    Nan::ThrowRangeError("Cannot take the square root of a negative number");
+    return;
+  }
+
+  AutoBN_CTX ctx;
+  BigNum *res = OutArg(info, 0);
+  bn_iroot(res->Bn(), bignum->Bn(), 2, ctx);
+
+  ReturnResult(info, 0, res);
+}
+
+NAN_METHOD(BigNum::Bsqrtrem)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  if (BN_is_negative(bignum->Bn())) {
+    Nan::ThrowRangeError("Cannot take the square root of a negative number");
+    return;
+  }
+
+  AutoBN_CTX ctx;
+  BigNum *root = new BigNum();
+  BigNum *rem = new BigNum();
+  bn_iroot(root->Bn(), bignum->Bn(), 2, ctx);
+  BN_sqr(rem->Bn(), root->Bn(), ctx);
+  BN_sub(rem->Bn(), bignum->Bn(), rem->Bn());
+
+  Local<Array> result = Nan::New<Array>(2);
+  Nan::Set(result, 0, NewInstance(root));
+  Nan::Set(result, 1, NewInstance(rem));
+
+  info.GetReturnValue().Set(result);
+}
+
+// Rounding of bdivmod's quotient; the values match DIVMOD_MODES in index.js
+enum DivmodMode { DIVMOD_TRUNC = 0, DIVMOD_FLOOR = 1, DIVMOD_EUCLID = 2 };
+
+/**
+ * bdivmod(d, mode)
+ *
+ * [q, r] with a = q*d + r from a single division. Truncating division
+ * leaves r with the sign of a, floor division gives it the sign of d and
+ * Euclidean division makes it non-negative. Inline small values are divided
+ * without touching OpenSSL.
+ */
+NAN_METHOD(BigNum::Bdivmod)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *bd = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  REQ_UINT32_ARG(1, mode);
+
+  if (bd->IsSmall() ? bd->SmallValue() == 0 : BN_is_zero(bd->Bn())) {
+    Nan::ThrowRangeError("Division by zero");
+    return;
+  }
+
+  BigNum *q = new BigNum();
+  BigNum *r = new BigNum();
+  if (bignum->IsSmall() && bd->IsSmall()) {
+    int64_t a = bignum->SmallValue();
+    int64_t d = bd->SmallValue();
+    int64_t qv = a / d;
+    int64_t rv = a % d;
+    // |d| >= 2 whenever r != 0, so the adjustments cannot overflow
+    bool adjust = rv != 0 && (mode == DIVMOD_FLOOR ? (rv < 0) != (d < 0) :
+                              mode == DIVMOD_EUCLID && rv < 0);
+    if (adjust && (mode == DIVMOD_FLOOR || d > 0)) {
+      qv--;
+      rv += d;
+    } else if (adjust) {
+      qv++;
+      rv -= d;
+    }
+    q->SetSmall(qv);
+    r->SetSmall(rv);
+  } else {
+    AutoBN_CTX ctx;
+    const BIGNUM *d = bd->Bn();
+    BN_div(q->Bn(), r->Bn(), bignum->Bn(), d, ctx);
+    bool adjust = !BN_is_zero(r->Bn()) &&
+      (mode == DIVMOD_FLOOR ? BN_is_negative(r->Bn()) != BN_is_negative(d) :
+       mode == DIVMOD_EUCLID && BN_is_negative(r->Bn()));
+    if (adjust && (mode == DIVMOD_FLOOR || !BN_is_negative(d))) {
+      BN_sub_word(q->Bn(), 1);
+      BN_add(r->Bn(), r->Bn(), d);
+    } else if (adjust) {
+      BN_add_word(q->Bn(), 1);
+      BN_sub(r->Bn(), r->Bn(), d);
+    }
+  }
+
+  Local<Array> result = Nan::New<Array>(2);
+  Nan::Set(result, 0, NewInstance(q));
+  Nan::Set(result, 1, NewInstance(r));
+
+  info.GetReturnValue().Set(result);
+}
+
+// bmuladd(b, c[, out]): a*b + c
+NAN_METHOD(BigNum::Bmuladd)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *b = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *c = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = OutArg(info, 2);
+
+  int64_t prod, sum;
+  if (bignum->IsSmall() && b->IsSmall() && c->IsSmall() &&
+      smallArith(ARITH_MUL, bignum->SmallValue(), b->SmallValue(), false, &prod) &&
+      smallArith(ARITH_ADD, prod, c->SmallValue(), false, &sum)) {
+    res->SetSmall(sum);
+  } else if (res == c) {
+    // c is still needed after the product is written
+    BN_CTX_start(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    BN_mul(t, bignum->Bn(), b->Bn(), ctx);
+    BN_add(res->Bn(), t, c->Bn());
+    BN_CTX_end(ctx);
+  } else {
+    BN_mul(res->Bn(), bignum->Bn(), b->Bn(), ctx);
+    BN_add(res->Bn(), res->Bn(), c->Bn());
+  }
+
+  ReturnResult(info, 2, res);
+}
+
+// Checks the modulus of the *mod methods, throwing if it is zero.
+static bool
+checkModulus(BigNum *m)
+{
+  if (BN_is_zero(m->Bn())) {
+    Nan::ThrowRangeError("Division by zero");
+    return false;
+  }
+  return true;
+}
+
+// bmulmod(b, m[, out]): a*b mod m, in [0, |m|)
+NAN_METHOD(BigNum::Bmulmod)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *b = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *m = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (!checkModulus(m)) {
+    return;
+  }
+  BigNum *res = OutArg(info, 2);
+
+  BN_mod_mul(res->Bn(), bignum->Bn(), b->Bn(), m->Bn(), ctx);
+
+  ReturnResult(info, 2, res);
+}
+
+// baddmod(b, m[, out]): a+b mod m, in [0, |m|)
+NAN_METHOD(BigNum::Baddmod)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *b = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *m = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (!checkModulus(m)) {
+    return;
+  }
+  BigNum *res = OutArg(info, 2);
+
+  BN_mod_add(res->Bn(), bignum->Bn(), b->Bn(), m->Bn(), ctx);
+
+  ReturnResult(info, 2, res);
+}
+
+// bsubmod(b, m[, out]): a-b mod m, in [0, |m|)
+NAN_METHOD(BigNum::Bsubmod)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *b = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *m = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (!checkModulus(m)) {
+    return;
+  }
+  BigNum *res = OutArg(info, 2);
+
+  BN_mod_sub(res->Bn(), bignum->Bn(), b->Bn(), m->Bn(), ctx);
+
+  ReturnResult(info, 2, res);
+}
+
+// bsqr([out]): a*a, which BN_sqr does in about two thirds of a BN_mul
+NAN_METHOD(BigNum::Bsqr)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  BigNum *res = OutArg(info, 0);
+
+  int64_t sq;
+  if (bignum->IsSmall() &&
+      smallArith(ARITH_MUL, bignum->SmallValue(), bignum->SmallValue(), false, &sq)) {
+    res->SetSmall(sq);
+  } else {
+    AutoBN_CTX ctx;
+    BN_sqr(res->Bn(), bignum->Bn(), ctx);
+  }
+
+  ReturnResult(info, 0, res);
+}
+
+NAN_METHOD(BigNum::Broot)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, k);
+  if (k == 0) {
+    Nan::ThrowRangeError("Root must be at least 1");
+    return;
+  }
+  bool neg = BN_is_negative(bignum->Bn());
+  if (neg && k % 2 == 0) {
+    Nan::ThrowRangeError("Cannot take an even root of a negative number");
+    return;
+  }
+
+  // Truncates towards zero, like division: root(-30, 3) == -3
+  AutoBN_CTX ctx;
+  BigNum *res = OutArg(info, 1);
+  BN_copy(res->Bn(), bignum->Bn());
+  BN_set_negative(res->Bn(), 0);
+  bn_iroot(res->Bn(), res->Bn(), k, ctx);
+  BN_set_negative(res->Bn(), neg);
+
+  ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(BigNum::Bisperfectpower)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  AutoBN_CTX ctx;
+  info.GetReturnValue().Set(Nan::New<Boolean>(bn_is_perfect_power(bignum->Bn(), ctx)));
+}
+
+NAN_METHOD(BigNum::BitLength)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  int size = bignum->NumBits();
+  Local<Value> result = Nan::New<Integer>(size);
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(BigNum::Bgcd)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bi = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = new BigNum();
+
+  BN_gcd(res->Bn(), bignum->Bn(), bi->Bn(), ctx);
+
+  WRAP_RESULT(res, result);
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(BigNum::Bjacobi)
+{
+  AutoBN_CTX ctx;
+  BigNum *bn_a = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  BigNum *bn_n = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  int res = 0;
+
+  if (BN_jacobi_priv(bn_a->Bn(), bn_n->Bn(), &res, ctx) == -1) {
+    Nan::ThrowError("Jacobi symbol calculation failed");
+    return;
+  }
+
+  info.GetReturnValue().Set(Nan::New<Integer>(res));
+}
+
+NAN_METHOD(BigNum::Bsetcompact)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  unsigned int nCompact = Nan::To<uint32_t>(info[0]).FromJust();
+  unsigned int nSize = nCompact >> 24;
+  bool fNegative     =(nCompact & 0x00800000) != 0;
+  unsigned int nWord = nCompact & 0x007fffff;
+  if (nSize <= 3)
+  {
+      nWord >>= 8*(3-nSize);
+      BN_set_word(bignum->Bn(), nWord);
+  }
+  else
+  {
+      BN_set_word(bignum->Bn(), nWord);
+      BN_lshift(bignum->Bn(), bignum->Bn(), 8*(nSize-3));
+  }
+  BN_set_negative(bignum->Bn(), fNegative);
+  bignum->InvalidateCache();
+  bignum->TrackMemory();
+
+  info.GetReturnValue().Set(info.This());
+}
+
+/**
+ * getCompact()
+ *
+ * The inverse of setCompact: the Bitcoin "nBits" form, a one-byte size in
+ * bytes followed by a 23-bit mantissa and a sign bit. Like Bitcoin Core,
+ * the mantissa is truncated rather than rounded.
+ */
+NAN_METHOD(BigNum::Bgetcompact)
+{
+  AutoBN_CTX ctx;
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  unsigned int nSize = BN_num_bytes(bignum->Bn());
+  unsigned int nCompact;
+  if (nSize <= 3) {
+    nCompact = BN_get_word(bignum->Bn()) << 8*(3-nSize);
+  } else {
+    BN_CTX_start(ctx);
+    BIGNUM *top = BN_CTX_get(ctx);
+    BN_rshift(top, bignum->Bn(), 8*(nSize-3));
+    nCompact = BN_get_word(top);
+    BN_CTX_end(ctx);
+  }
+  // The 0x00800000 bit is the sign, so a mantissa using it moves up a byte
+  if (nCompact & 0x00800000) {
+    nCompact >>= 8;
+    nSize++;
+  }
+  if (nSize > 0xff) {
+    Nan::ThrowRangeError("Value is too large for the compact format");
+    return;
+  }
+  nCompact |= nSize << 24;
+  if (BN_is_negative(bignum->Bn()) && (nCompact & 0x007fffff)) {
+    nCompact |= 0x00800000;
+  }
+
+  info.GetReturnValue().Set(Nan::New<Uint32>(nCompact));
+}
+
+// Signed integer encodings understood by bencode and bdecode
+enum IntFormat {
+  FORMAT_MPINT = 0, // RFC 4251 mpint: uint32 length, then the value
+  FORMAT_DER = 1    // X.690 DER INTEGER: tag 0x02, length, then the value
+};
+
+/**
+ * Length in bytes of the minimal big endian two's complement form of bn, the
+ * content of both an mpint and a DER INTEGER. Zero has no bytes (DER pads it
+ * to one). A top bit that is set needs an extra sign byte, except that
+ * -2^(8k-1) still fits in k bytes.
+ */
+static size_t
+signedByteLength(const BIGNUM *bn)
+{
+  if (BN_is_zero(bn)) {
+    return 0;
+  }
+
+  int bits = BN_num_bits(bn);
+  if (BN_is_negative(bn)) {
+    int low = 0;
+    while (!BN_is_bit_set(bn, low)) {
+      low++;
+    }
+    if (low == bits - 1) {
+      bits--;
+    }
+  }
+  return bits / 8 + 1;
+}
+
+// Two's complement negation of a big endian byte string, in place.
+static void
+negateBytes(unsigned char *data, size_t len)
+{
+  unsigned int carry = 1;
+  for (size_t i = len; i-- > 0;) {
+    unsigned int v = (unsigned char) ~data[i] + carry;
+    data[i] = v & 0xff;
+    carry = v >> 8;
+  }
+}
+
+// Writes bn as len bytes of big endian two's complement.
+static void
+writeSigned(const BIGNUM *bn, unsigned char *out, size_t len)
+{
+  BN_bn2binpad(bn, out, len);
+  if (BN_is_negative(bn)) {
+    negateBytes(out, len);
+  }
+}
+
+// Reads len bytes of big endian two's complement into bn.
+static void
+readSigned(BIGNUM *bn, const unsigned char *in, size_t len)
+{
+  if (len == 0 || !(in[0] & 0x80)) {
+    BN_bin2bn(in, len, bn);
+    return;
+  }
+
+  vector<unsigned char> tmp(in, in + len);
+  negateBytes(&tmp[0], len);
+  BN_bin2bn(&tmp[0], len, bn);
+  BN_set_negative(bn, 1);
+}
+
+/**
+ * bencode(format[, target, offset])
+ *
+ * Serializes the value as an SSH mpint or a DER INTEGER, into a new Buffer
+ * or, like tobuffer, into target at offset returning the bytes written.
+ */
+NAN_METHOD(BigNum::Bencode)
+{
+  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+
+  REQ_UINT32_ARG(0, format);
+
+  size_t content = signedByteLength(bignum->Bn());
+  size_t header;
+  if (format == FORMAT_MPINT) {
+    if (content > 0xffffffffUL) {
+      Nan::ThrowRangeError("Value is too large for an mpint");
+      return;
+    }
+    header = 4;
+  } else if (format == FORMAT_DER) {
+    if (content == 0) {
+      content = 1;
+    }
+    header = 2;
+    for (size_t n = content; content >= 0x80 && n > 0; n >>= 8) {
+      header++;
+    }
+  } else {
+    Nan::ThrowTypeError("Unsupported integer format");
+    return;
+  }
+  size_t len = header + content;
+
+  bool toTarget = info.Length() > 1 && node::Buffer::HasInstance(info[1]);
+  Local<Object> buf;
+  unsigned char *data;
+  if (toTarget) {
+    REQ_UINT32_ARG(2, offset);
+    size_t avail = node::Buffer::Length(info[1]);
+    if (offset > avail || len > avail - offset) {
+      Nan::ThrowRangeError("Target buffer is too small");
+      return;
+    }
+    data = (unsigned char *) node::Buffer::Data(info[1]) + offset;
+  } else {
+    buf = Nan::NewBuffer(len).ToLocalChecked();
+    data = (unsigned char *) node::Buffer::Data(buf);
+  }
+
+  if (format == FORMAT_MPINT) {
+    data[0] = (content >> 24) & 0xff;
+    data[1] = (content >> 16) & 0xff;
+    data[2] = (content >> 8) & 0xff;
+    data[3] = content & 0xff;
+  } else {
+    data[0] = 0x02;
+    if (header == 2) {
+      data[1] = content;
+    } else {
+      data[1] = 0x80 | (header - 2);
+      for (size_t i = header - 1, n = content; i >= 2; i--, n >>= 8) {
+        data[i] = n & 0xff;
+      }
+    }
+  }
+  writeSigned(bignum->Bn(), data + header, content);
+
+  if (toTarget) {
+    info.GetReturnValue().Set(Nan::New<Number>(len));
+  } else {
+    info.GetReturnValue().Set(buf);
+  }
+}
+
+/**
+ * Parses the header of one encoded integer at data[0..avail). Sets the
+ * header and content lengths and returns NULL, or returns an error message.
+ */
+static const char *
+parseIntHeader(uint32_t format, const unsigned char *data, size_t avail,
+               size_t *header, size_t *content)
+{
+  if (format == FORMAT_MPINT) {
+    if (avail < 4) {
+      return "Truncated mpint length";
+    }
+    *header = 4;
+    *content = ((size_t) data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+  } else {
+    if (avail < 2) {
+      return "Truncated DER INTEGER header";
+    }
+    if (data[0] != 0x02) {
+      return "Expected a DER INTEGER";
+    }
+    if (data[1] < 0x80) {
+      *header = 2;
+      *content = data[1];
+    } else {
+      size_t n = data[1] & 0x7f;
+      if (n == 0 || n > 4) {
+        return "Unsupported DER length";
+      }
+      if (avail < 2 + n) {
+        return "Truncated DER INTEGER header";
+      }
+      *header = 2 + n;
+      *content = 0;
+      for (size_t i = 0; i < n; i++) {
+        *content = (*content << 8) | data[2 + i];
+      }
+      // X.690 10.1: the long form only for 128 or more, without leading zeros
+      if (data[2] == 0 || *content < 0x80) {
+        return "Non-minimal DER length";
+      }
+    }
+    if (*content == 0) {
+      return "Empty DER INTEGER";
+    }
+  }
+  if (avail - *header < *content) {
+    return "Truncated integer";
+  }
+
+  // Both formats forbid redundant sign bytes (X.690 8.3.2, RFC 4251 5): a
+  // leading 0x00 must be needed to keep the value positive and a leading
+  // 0xff to keep it negative. An mpint zero has no content at all.
+  const unsigned char *c = data + *header;
+  bool redundant = *content >= 2 &&
+    ((c[0] == 0x00 && !(c[1] & 0x80)) || (c[0] == 0xff && (c[1] & 0x80)));
+  if (format == FORMAT_MPINT && *content == 1 && c[0] == 0x00) {
+    redundant = true;
+  }
+  if (redundant) {
+    return format == FORMAT_MPINT ? "Non-minimal mpint" : "Non-minimal DER INTEGER";
+  }
+  return NULL;
+}
+
+/**
+ * bdecode(buf, format, offset, count)
+ *
+ * Decodes up to count integers (0 for as many as the buffer holds) laid end
+ * to end from offset, straight from the Buffer's bytes. Returns an array of
+ * BigNums whose bytesRead property is the number of bytes consumed.
+ */
+NAN_METHOD(BigNum::Bdecode)
+{
+  if (info.Length() < 1 || !node::Buffer::HasInstance(info[0])) {
+    Nan::ThrowTypeError("Argument 0 must be a Buffer");
+    return;
+  }
+  REQ_UINT32_ARG(1, format);
+  REQ_UINT32_ARG(2, offset);
+  REQ_UINT32_ARG(3, count);
+
+  if (format != FORMAT_MPINT && format != FORMAT_DER) {
+    Nan::ThrowTypeError("Unsupported integer format");
+    return;
+  }
+
+  const unsigned char *data = (const unsigned char *) node::Buffer::Data(info[0]);
+  size_t len = node::Buffer::Length(info[0]);
+  if (offset > len) {
+    Nan::ThrowRangeError("Offset is out of bounds");
+    return;
+  }
+
+  Local<Array> result = Nan::New<Array>();
+  size_t pos = offset;
+  uint32_t n = 0;
+  while (count == 0 ? pos < len : n < count) {
+    size_t header, content;
+    const char *err = parseIntHeader(format, data + pos, len - pos, &header, &content);
+    if (err != NULL) {
+      Nan::ThrowRangeError(err);
+      return;
+    }
+
+    BigNum *res = new BigNum();
+    readSigned(res->Bn(), data + pos + header, content);
+    Nan::Set(result, n++, NewInstance(res));
+    pos += header + content;
+  }
+
+  Nan::Set(result, Nan::New("bytesRead").ToLocalChecked(), Nan::New<Number>(pos - offset));
+  info.GetReturnValue().Set(result);
+}
+
+/**
+ * The elements of a batch call: either a JS array of BigNums, numbers and
+ * decimal strings, or a Buffer of packed unsigned integers of size bytes
+ * each. BigNum elements are used in place; everything else is converted
+ * into a caller-provided scratch BIGNUM.
+ */
+class BatchInput
+{
+public:
+  BatchInput(Local<Value> list, uint32_t size, bool little)
+    : size_(size), little_(little), data_(NULL), length_(0)
+  {
+    if (list->IsArray()) {
+      array_ = list.As<Array>();
+      length_ = array_->Length();
+    } else if (node::Buffer::HasInstance(list)) {
+      data_ = (const unsigned char *) node::Buffer::Data(list);
+      if (size_ > 0) {
+        length_ = node::Buffer::Length(list) / size_;
+      }
+    }
+  }
+
+  // Throws and returns false if list was neither form.
+  static bool Check(Local<Value> list, uint32_t size, const char *name)
+  {
+    if (list->IsArray()) {
+      return true;
+    }
+    if (!node::Buffer::HasInstance(list)) {
+      Nan::ThrowTypeError((string(name) + " must be an array or a Buffer").c_str());
+      return false;
+    }
+    if (size == 0 || node::Buffer::Length(list) % size != 0) {
+      Nan::ThrowRangeError((string(name) + " length must be a multiple of size").c_str());
+      return false;
+    }
+    return true;
+  }
+
+  size_t Length() const { return length_; }
+
+  // Element i, or NULL after throwing if it cannot be converted.
+  const BIGNUM* Get(size_t i, BIGNUM *scratch)
+  {
+    if (data_ != NULL) {
+      if (little_) {
+        BN_lebin2bn(data_ + i * size_, size_, scratch);
+      } else {
+        BN_bin2bn(data_ + i * size_, size_, scratch);
+      }
+      return scratch;
+    }
+
+    Local<Value> v = Nan::Get(array_, i).ToLocalChecked();
+    return Scalar(v, scratch);
+  }
+
+  // A single BigNum, number or decimal string, or NULL after throwing.
+  static const BIGNUM* Scalar(Local<Value> v, BIGNUM *scratch)
+  {
+    if (BigNum::HasInstance(v)) {
+      return Nan::ObjectWrap::Unwrap<BigNum>(v.As<Object>())->Bn();
+    }
+    if (v->IsNumber()) {
+      BN_set_double(scratch, Nan::To<double>(v).FromJust());
+      return scratch;
+    }
+    if (v->IsString()) {
+      Nan::Utf8String str(v);
+      BIGNUM *bn = scratch;
+      if (BN_dec2bn(&bn, *str) > 0) {
+        return scratch;
+      }
+    }
+    Nan::ThrowTypeError("Batch elements must be BigNums, numbers or decimal strings");
+    return NULL;
+  }
+
+private:
+  uint32_t size_;
+  bool little_;
+  const unsigned char *data_;
+  Local<Array> array_;
+  size_t length_;
+};
+
+// bsum(list, size, little)
+NAN_METHOD(BigNum::Bsum)
+{
+  REQ_UINT32_ARG(1, size);
+  REQ_BOOL_ARG(2, little);
+  if (!BatchInput::Check(info[0], size, "List")) {
+    return;
+  }
+
+  BatchInput list(info[0], size, little);
+  BigNum *res = new BigNum();
+  BIGNUM *scratch = BN_new();
+  for (size_t i = 0; i < list.Length(); i++) {
+    const BIGNUM *x = list.Get(i, scratch);
+    if (x == NULL) {
+      BN_free(scratch);
+      delete res;
+      return;
+    }
+    BN_add(res->Bn(), res->Bn(), x);
+  }
+  BN_free(scratch);
+
+  info.GetReturnValue().Set(NewInstance(res));
+}
+
+/**
+ * bproduct(list, size, little)
+ *
+ * Multiplies pairwise up a balanced tree, so the large multiplications near
+ * the root have operands of similar size and get OpenSSL's Karatsuba path,
+ * instead of one ever-growing accumulator multiplied by small factors.
+ */
+NAN_METHOD(BigNum::Bproduct)
+{
+  REQ_UINT32_ARG(1, size);
+  REQ_BOOL_ARG(2, little);
+  if (!BatchInput::Check(info[0], size, "List")) {
+    return;
+  }
+
+  AutoBN_CTX ctx;
+  BatchInput list(info[0], size, little);
+  size_t n = list.Length();
+
+  // The first level multiplies neighbouring elements straight from the input
+  vector<BIGNUM*> level;
+  BIGNUM *a = BN_new();
+  BIGNUM *b = BN_new();
+  bool ok = true;
+  for (size_t i = 0; i < n; i += 2) {
+    const BIGNUM *x = list.Get(i, a);
+    const BIGNUM *y = NULL;
+    if (x != NULL && i + 1 < n && (y = list.Get(i + 1, b)) == NULL) {
+      x = NULL;
+    }
+    if (x == NULL) {
+      ok = false;
+      break;
+    }
+    BIGNUM *p = BN_new();
+    if (y != NULL) {
+      BN_mul(p, x, y, ctx);
+    } else {
+      BN_copy(p, x);
+    }
+    level.push_back(p);
+  }
+  BN_free(a);
+  BN_free(b);
+
+  while (ok && level.size() > 1) {
+    size_t half = 0;
+    for (size_t i = 0; i < level.size(); i += 2) {
+      if (i + 1 < level.size()) {
+        BN_mul(level[i], level[i], level[i + 1], ctx);
+        BN_free(level[i + 1]);
+      }
+      level[half++] = level[i];
+    }
+    level.resize(half);
+  }
+
+  if (!ok) {
+    for (size_t i = 0; i < level.size(); i++) {
+      BN_free(level[i]);
+    }
+    return;
+  }
+
+  BigNum *res = new BigNum();
+  if (level.empty()) {
+    BN_one(res->Bn());
+  } else {
+    BN_copy(res->Bn(), level[0]);
+    BN_free(level[0]);
+  }
+
+  info.GetReturnValue().Set(NewInstance(res));
+}
+
+enum BatchOp { BATCH_ADD, BATCH_MUL, BATCH_MOD };
+
+/**
+ * Elementwise list[i] op other, where other is a single value or a list of
+ * the same length. Returns an array of new BigNums.
+ */
+void
+BigNum::BatchMap(Nan::NAN_METHOD_ARGS_TYPE info, int op)
+{
+  REQ_UINT32_ARG(2, size);
+  REQ_BOOL_ARG(3, little);
+  if (!BatchInput::Check(info[0], size, "List")) {
+    return;
+  }
+
+  BatchInput list(info[0], size, little);
+  size_t n = list.Length();
+
+  bool pairwise = info[1]->IsArray() || node::Buffer::HasInstance(info[1]);
+  if (pairwise && !BatchInput::Check(info[1], size, "Other")) {
+    return;
+  }
+  BatchInput others(pairwise ? info[1] : Local<Value>(Nan::Undefined()), size, little);
+  if (pairwise && others.Length() != n) {
+    Nan::ThrowRangeError("Lists must have the same length");
+    return;
+  }
+
+  AutoBN_CTX ctx;
+  BN_CTX_start(ctx);
+  BIGNUM *xs = BN_CTX_get(ctx);
+  BIGNUM *ys = BN_CTX_get(ctx);
+
+  const BIGNUM *y = pairwise ? NULL : BatchInput::Scalar(info[1], ys);
+  if (!pairwise && y == NULL) {
+    BN_CTX_end(ctx);
+    return;
+  }
+  if (op == BATCH_MOD && !pairwise && BN_is_zero(y)) {
+    BN_CTX_end(ctx);
+    Nan::ThrowRangeError("Division by zero");
+    return;
+  }
+
+  Local<Array> result = Nan::New<Array>(n);
+  for (size_t i = 0; i < n; i++) {
+    const BIGNUM *x = list.Get(i, xs);
+    if (x == NULL || (pairwise && (y = others.Get(i, ys)) == NULL)) {
+      BN_CTX_end(ctx);
+      return;
+    }
+
+    BigNum *res = new BigNum();
+    switch (op) {
+    case BATCH_ADD:
+      BN_add(res->Bn(), x, y);
+      break;
+    case BATCH_MUL:
+      BN_mul(res->Bn(), x, y, ctx);
+      break;
+    case BATCH_MOD:
+      if (BN_is_zero(y)) {
+        delete res;
+        BN_CTX_end(ctx);
+        Nan::ThrowRangeError("Division by zero");
+        return;
+      }
+      BN_div(NULL, res->Bn(), x, y, ctx);
+      break;
+    }
+    Nan::Set(result, i, NewInstance(res));
+  }
+  BN_CTX_end(ctx);
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(BigNum::Baddmany)
+{
+  BatchMap(info, BATCH_ADD);
+}
+
+NAN_METHOD(BigNum::Bmulmany)
+{
+  BatchMap(info, BATCH_MUL);
+}
+
+NAN_METHOD(BigNum::Bmodmany)
+{
+  BatchMap(info, BATCH_MOD);
+}
+
+/**
+ * Expression programs built by BigNum.expr() in JS. Each node is four int32s,
+ * an opcode and up to three operands; an operand >= 0 names an earlier node
+ * and -(i + 1) names leaves[i]. The last node is the result.
+ */
+enum ExprOp {
+  EXPR_ADD = 1,
+  EXPR_SUB,
+  EXPR_MUL,
+  EXPR_DIV,
+  EXPR_MOD,
+  EXPR_POWM,
+  EXPR_NEG,
+  EXPR_ABS,
+  EXPR_SQR
+};
+
+static const int kExprWidth = 4;
+
+static int
+exprArity(int op)
+{
+  switch (op) {
+  case EXPR_ADD: case EXPR_SUB: case EXPR_MUL: case EXPR_DIV: case EXPR_MOD:
+    return 2;
+  case EXPR_POWM:
+    return 3;
+  case EXPR_NEG: case EXPR_ABS: case EXPR_SQR:
+    return 1;
+  default:
+    return -1;
+  }
+}
+
+/**
+ * r = a * b mod m with the sign of BN_div's remainder, so that a fused
+ * mul+mod gives what the two separate steps would. BN_mod_mul reduces into
+ * [0, |m|) and skips materializing the full product as a node of its own.
+ */
+static int
+mod_mul_truncated(BIGNUM *r, const BIGNUM *a, const BIGNUM *b, const BIGNUM *m, BN_CTX *ctx)
+{
+  bool neg = !BN_is_zero(a) && !BN_is_zero(b) && BN_is_negative(a) != BN_is_negative(b);
+  bool sqr = a == b;
+  if (!(sqr ? BN_mod_sqr(r, a, m, ctx) : BN_mod_mul(r, a, b, m, ctx))) {
+    return 0;
+  }
+  if (neg && !BN_is_zero(r)) {
+    // r is in (0, |m|); the truncated remainder is r - |m|
+    if (!BN_usub(r, m, r)) {
+      return 0;
+    }
+    BN_set_negative(r, 1);
+  }
+  return 1;
+}
+
+// bevalexpr(program, leaves)
+NAN_METHOD(BigNum::Bevalexpr)
+{
+  Nan::TypedArrayContents<int32_t> program(info[0]);
+  if (info.Length() < 2 || !info[0]->IsInt32Array() || !info[1]->IsArray()) {
+    Nan::ThrowTypeError("Expected an Int32Array program and an array of leaves");
+    return;
+  }
+  Local<Array> leafList = info[1].As<Array>();
+  size_t nodes = program.length() / kExprWidth;
+  const int32_t *code = *program;
+  if (nodes == 0 || program.length() % kExprWidth != 0) {
+    Nan::ThrowTypeError("Empty or truncated expression program");
+    return;
+  }
+
+  vector<const BIGNUM*> leaves(leafList->Length());
+  for (size_t i = 0; i < leaves.size(); i++) {
+    Local<Value> leaf = Nan::Get(leafList, i).ToLocalChecked();
+    if (!HasInstance(leaf)) {
+      Nan::ThrowTypeError("Expression leaves must be BigNums");
+      return;
+    }
+    leaves[i] = Nan::ObjectWrap::Unwrap<BigNum>(leaf.As<Object>())->Bn();
+  }
+
+  // Validate, count uses and find where each node is last needed
+  vector<int> uses(nodes, 0);
+  vector<size_t> lastUse(nodes, 0);
+  for (size_t n = 0; n < nodes; n++) {
+    const int32_t *node = code + n * kExprWidth;
+    int arity = exprArity(node[0]);
+    if (arity < 0) {
+      Nan::ThrowTypeError("Unknown expression opcode");
+      return;
+    }
+    for (int k = 1; k <= arity; k++) {
+      int32_t ref = node[k];
+      if (ref >= (int32_t) n || (ref < 0 && (size_t) -(ref + 1) >= leaves.size())) {
+        Nan::ThrowTypeError("Expression operand out of range");
+        return;
+      }
+      if (ref >= 0) {
+        uses[ref]++;
+        lastUse[ref] = n;
+      }
+    }
+  }
+
+  // A product feeding only a mod is folded into it, so the product's
+  // operands now live until the mod
+  vector<bool> fused(nodes, false);
+  for (size_t n = 0; n < nodes; n++) {
+    const int32_t *node = code + n * kExprWidth;
+    if (node[0] == EXPR_MOD && node[1] >= 0 && uses[node[1]] == 1) {
+      const int32_t *prod = code + node[1] * kExprWidth;
+      if (prod[0] == EXPR_MUL || prod[0] == EXPR_SQR) {
+        fused[node[1]] = true;
+        for (int k = 1; k <= exprArity(prod[0]); k++) {
+          if (prod[k] >= 0) {
+            lastUse[prod[k]] = max(lastUse[prod[k]], n);
+          }
+        }
+      }
+    }
+  }
+
+  AutoBN_CTX ctx;
+  BN_CTX_start(ctx);
+  vector<BIGNUM*> values(nodes, (BIGNUM*) NULL);
+  vector<BIGNUM*> spare;
+  BigNum *res = new BigNum();
+  const char *error = NULL;
+
+  for (size_t n = 0; n < nodes && error == NULL; n++) {
+    const int32_t *node = code + n * kExprWidth;
+    if (fused[n]) {
+      continue;
+    }
+
+    const BIGNUM *arg[3] = { NULL, NULL, NULL };
+    for (int k = 0; k < exprArity(node[0]); k++) {
+      int32_t ref = node[k + 1];
+      arg[k] = ref < 0 ? leaves[-(ref + 1)] : values[ref];
+    }
+
+    BIGNUM *r;
+    if (n == nodes - 1) {
+      r = res->Bn();
+    } else if (!spare.empty()) {
+      r = spare.back();
+      spare.pop_back();
+    } else {
+      r = BN_CTX_get(ctx);
+    }
+
+    int ok = r != NULL;
+    switch (node[0]) {
+    case EXPR_ADD:
+      ok = ok && BN_add(r, arg[0], arg[1]);
+      break;
+    case EXPR_SUB:
+      ok = ok && BN_sub(r, arg[0], arg[1]);
+      break;
+    case EXPR_MUL:
+      ok = ok && (arg[0] == arg[1] ? BN_sqr(r, arg[0], ctx) : BN_mul(r, arg[0], arg[1], ctx));
+      break;
+    case EXPR_SQR:
+      ok = ok && BN_sqr(r, arg[0], ctx);
+      break;
+    case EXPR_DIV:
+    case EXPR_MOD:
+      if (BN_is_zero(arg[1])) {
+        error = "Division by zero";
+        break;
+      }
+      if (node[0] == EXPR_MOD && node[1] >= 0 && fused[node[1]]) {
+        const int32_t *prod = code + node[1] * kExprWidth;
+        const BIGNUM *x = prod[1] < 0 ? leaves[-(prod[1] + 1)] : values[prod[1]];
+        const BIGNUM *y = x;
+        if (prod[0] == EXPR_MUL) {
+          y = prod[2] < 0 ? leaves[-(prod[2] + 1)] : values[prod[2]];
+        }
+        ok = ok && mod_mul_truncated(r, x, y, arg[1], ctx);
+      } else if (node[0] == EXPR_DIV) {
+        ok = ok && BN_div(r, NULL, arg[0], arg[1], ctx);
+      } else {
+        ok = ok && BN_div(NULL, r, arg[0], arg[1], ctx);
+      }
+      break;
+    case EXPR_POWM:
+      if (BN_is_zero(arg[2])) {
+        error = "Division by zero";
+        break;
+      }
+      if (node[3] < 0) {
+        // A leaf modulus keeps its Montgomery context across evaluations
+        Local<Value> m = Nan::Get(leafList, -(node[3] + 1)).ToLocalChecked();
+        ok = ok && mod_exp(r, arg[0], arg[1], Nan::ObjectWrap::Unwrap<BigNum>(m.As<Object>()), ctx);
+      } else {
+        ok = ok && BN_mod_exp(r, arg[0], arg[1], arg[2], ctx);
+      }
+      break;
+    case EXPR_NEG:
+      ok = ok && BN_copy(r, arg[0]);
+      if (ok && !BN_is_zero(r)) {
+        BN_set_negative(r, !BN_is_negative(r));
+      }
+      break;
+    case EXPR_ABS:
+      ok = ok && BN_copy(r, arg[0]);
+      if (ok) {
+        BN_set_negative(r, 0);
+      }
+      break;
+    }
+    if (!ok && error == NULL) {
+      error = "Expression evaluation failed";
+    }
+    values[n] = r;
+
+    // Operands needed by nobody after this node go back to the pool
+    for (int k = 1; k <= exprArity(node[0]); k++) {
+      int32_t ref = node[k];
+      if (ref >= 0 && fused[ref]) {
+        const int32_t *prod = code + ref * kExprWidth;
+        for (int j = 1; j <= exprArity(prod[0]); j++) {
+          if (prod[j] >= 0 && lastUse[prod[j]] == n && values[prod[j]] != NULL) {
+            spare.push_back(values[prod[j]]);
+            values[prod[j]] = NULL;
+          }
+        }
+      }
+      if (ref >= 0 && lastUse[ref] == n && values[ref] != NULL) {
+        spare.push_back(values[ref]);
+        values[ref] = NULL;
+      }
+    }
+  }
+  BN_CTX_end(ctx);
+
+  if (error != NULL) {
+    delete res;
+    if (strcmp(error, "Division by zero") == 0) {
+      Nan::ThrowRangeError(error);
+    } else {
+      Nan::ThrowError(error);
+    }
+    return;
+  }
+
+  info.GetReturnValue().Set(NewInstance(res));
+}
+
+// The base-2^w digits of e >= 0, least significant first.
+static void
+exponentDigits(vector<unsigned int> &digits, const BIGNUM *e, int w)
+{
+  int bits = BN_num_bits(e);
+  digits.assign((bits + w - 1) / w, 0);
+  for (int i = 0; i < bits; i++) {
+    if (BN_is_bit_set(e, i)) {
+      digits[i / w] |= 1u << (i % w);
+    }
+  }
+}
+
+/**
+ * r = prod b_i^e_i mod m by Straus' interleaving: one shared chain of
+ * squarings, with a fixed window of each base's powers folded in at every
+ * digit. Bases must be reduced and exponents non-negative.
+ */
+static void
+multi_exp_mont(BIGNUM *r, const vector<BIGNUM*> &bases,
+               const vector<BIGNUM*> &exps, const BIGNUM *m,
+               BN_MONT_CTX *mont, BN_CTX *ctx)
+{
+  int maxBits = 0;
+  for (size_t i = 0; i < exps.size(); i++) {
+    maxBits = max(maxBits, BN_num_bits(exps[i]));
+  }
+  int w = maxBits > 512 ? 5 : maxBits > 128 ? 4 : maxBits > 32 ? 3 : 2;
+  size_t size = (size_t) 1 << w;
+
+  // table[i * size + j] = b_i^j in Montgomery form
+  vector<BIGNUM*> table(bases.size() * size, (BIGNUM *) NULL);
+  vector<vector<unsigned int> > digits(bases.size());
+  for (size_t i = 0; i < bases.size(); i++) {
+    exponentDigits(digits[i], exps[i], w);
+    digits[i].resize((maxBits + w - 1) / w, 0);
+    for (size_t j = 1; j < size; j++) {
+      BIGNUM *t = table[i * size + j] = BN_new();
+      if (j == 1) {
+        BN_to_montgomery(t, bases[i], mont, ctx);
+      } else {
+        BN_mod_mul_montgomery(t, table[i * size + j - 1], table[i * size + 1], mont, ctx);
+      }
+    }
+  }
+
+  BN_CTX_start(ctx);
+  BIGNUM *acc = BN_CTX_get(ctx);
+  bool started = false;
+  for (int pos = (maxBits + w - 1) / w - 1; pos >= 0; pos--) {
+    if (started) {
+      for (int k = 0; k < w; k++) {
+        BN_mod_mul_montgomery(acc, acc, acc, mont, ctx);
+      }
+    }
+    for (size_t i = 0; i < bases.size(); i++) {
+      unsigned int d = digits[i][pos];
+      if (d == 0) {
+        continue;
+      }
+      if (started) {
+        BN_mod_mul_montgomery(acc, acc, table[i * size + d], mont, ctx);
+      } else {
+        BN_copy(acc, table[i * size + d]);
+        started = true;
+      }
+    }
+  }
+
+  if (started) {
+    BN_from_montgomery(r, acc, mont, ctx);
+  } else {
+    BN_one(r);
+    BN_nnmod(r, r, m, ctx);
+  }
+  BN_CTX_end(ctx);
+
+  for (size_t i = 0; i < table.size(); i++) {
+    BN_clear_free(table[i]);
+  }
+}
+
+// bmultipowm([[b1, e1], [b2, e2], ...], mod)
+NAN_METHOD(BigNum::Bmultipowm)
+{
+  if (info.Length() < 1 || !info[0]->IsArray()) {
+    Nan::ThrowTypeError("Argument 0 must be an array of [base, exponent] pairs");
+    return;
+  }
+  BigNum *m = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (BN_is_zero(m->Bn())) {
+    Nan::ThrowRangeError("Division by zero");
+    return;
+  }
+
+  Local<Array> pairs = info[0].As<Array>();
+  uint32_t n = pairs->Length();
+
+  AutoBN_CTX ctx;
+  vector<BIGNUM*> bases, exps;
+  BIGNUM *scratch = BN_new();
+  bool ok = true;
+  for (uint32_t i = 0; i < n && ok; i++) {
+    Local<Value> pair = Nan::Get(pairs, i).ToLocalChecked();
+    if (!pair->IsArray()) {
+      Nan::ThrowTypeError("Argument 0 must be an array of [base, exponent] pairs");
+      ok = false;
+      break;
+    }
+    const BIGNUM *b = BatchInput::Scalar(Nan::Get(pair.As<Array>(), 0).ToLocalChecked(), scratch);
+    if (b == NULL) {
+      ok = false;
+      break;
+    }
+    bases.push_back(BN_new());
+    BN_nnmod(bases.back(), b, m->Bn(), ctx);
+
+    const BIGNUM *e = BatchInput::Scalar(Nan::Get(pair.As<Array>(), 1).ToLocalChecked(), scratch);
+    if (e == NULL) {
+      ok = false;
+      break;
+    }
+    if (BN_is_negative(e)) {
+      Nan::ThrowRangeError("Exponent must not be negative");
+      ok = false;
+      break;
+    }
+    exps.push_back(BN_dup(e));
+  }
+  BN_free(scratch);
+
+  BigNum *res = NULL;
+  if (ok) {
+    res = new BigNum();
+    BN_MONT_CTX *mont = m->MontCtx(ctx);
+    if (mont != NULL) {
+      multi_exp_mont(res->Bn(), bases, exps, m->Bn(), mont, ctx);
+    } else {
+      // Montgomery needs an odd modulus; otherwise go one at a time
+      BIGNUM *t = BN_new();
+      BN_one(res->Bn());
+      BN_nnmod(res->Bn(), res->Bn(), m->Bn(), ctx);
+      for (size_t i = 0; i < bases.size(); i++) {
+        BN_mod_exp(t, bases[i], exps[i], m->Bn(), ctx);
+        BN_mod_mul(res->Bn(), res->Bn(), t, m->Bn(), ctx);
+      }
+      BN_free(t);
+    }
+  }
+
+  for (size_t i = 0; i < bases.size(); i++) {
+    BN_clear_free(bases[i]);
+  }
+  for (size_t i = 0; i < exps.size(); i++) {
+    BN_clear_free(exps[i]);
+  }
+
+  if (res != NULL) {
+    info.GetReturnValue().Set(NewInstance(res));
+  }
+}
+
+/**
+ * A fixed odd modulus together with its Montgomery context, for code that
+ * does many modular multiplications or exponentiations by the same modulus.
+ * Inputs and outputs are ordinary BigNums; only the setup is amortized.
+ */
+class Montgomery : public Nan::ObjectWrap {
+public:
+  static void Initialize(Local<Object> target);
+
+protected:
+  static Nan::Persistent<FunctionTemplate> constructor_template;
+
+  BIGNUM *mod_;
+  BN_MONT_CTX *mont_;
+
+  Montgomery();
+  ~Montgomery();
+
+  // Reduces a into [0, mod) if needed; returns a or tmp.
+  const BIGNUM* Reduce(const BIGNUM *a, BIGNUM *tmp, BN_CTX *ctx);
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Bpowm);
+  static NAN_METHOD(Bmulm);
+  static NAN_METHOD(Bsqrm);
+};
+
+Nan::Persistent<FunctionTemplate> Montgomery::constructor_template;
+
+void Montgomery::Initialize(v8::Local<v8::Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
+  constructor_template.Reset(tmpl);
+
+  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tmpl->SetClassName(Nan::New("Montgomery").ToLocalChecked());
+
+  Nan::SetPrototypeMethod(tmpl, "bpowm", Instrumented<Bpowm>::Register("Montgomery.bpowm"));
+  Nan::SetPrototypeMethod(tmpl, "bmulm", Instrumented<Bmulm>::Register("Montgomery.bmulm"));
+  Nan::SetPrototypeMethod(tmpl, "bsqrm", Instrumented<Bsqrm>::Register("Montgomery.bsqrm"));
+
+  Nan::Set(target, Nan::New("Montgomery").ToLocalChecked(), Nan::GetFunction(tmpl).ToLocalChecked());
+}
+
+Montgomery::Montgomery() : Nan::ObjectWrap (),
+    mod_(BN_new()), mont_(BN_MONT_CTX_new())
+{
+}
+
+Montgomery::~Montgomery()
+{
+  BN_MONT_CTX_free(mont_);
+  BN_clear_free(mod_);
+}
+
+const BIGNUM* Montgomery::Reduce(const BIGNUM *a, BIGNUM *tmp, BN_CTX *ctx)
+{
+  if (!BN_is_negative(a) && BN_ucmp(a, mod_) < 0) {
+    return a;
+  }
+  BN_nnmod(tmp, a, mod_, ctx);
+  return tmp;
+}
+
+NAN_METHOD(Montgomery::New)
+{
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("Montgomery must be called with new");
+    return;
+  }
+
+  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (!BN_is_odd(bn->Bn()) || BN_is_negative(bn->Bn())) {
+    Nan::ThrowRangeError("Montgomery modulus must be a positive odd number");
+    return;
+  }
+
+  AutoBN_CTX ctx;
+  Montgomery *mont = new Montgomery();
+  BN_copy(mont->mod_, bn->Bn());
+  if (!BN_MONT_CTX_set(mont->mont_, mont->mod_, ctx)) {
+    delete mont;
+    Nan::ThrowError("Montgomery context setup failed");
+    return;
+  }
+
+  mont->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(Montgomery::Bpowm)
+{
+  AutoBN_CTX ctx;
+  Montgomery *mont = Nan::ObjectWrap::Unwrap<Montgomery>(info.This());
+
+  BigNum *base = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *exp = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (BN_is_negative(exp->Bn())) {
+    Nan::ThrowRangeError("Exponent must not be negative");
+    return;
+  }
+  BigNum *res = new BigNum();
+  mod_exp_mont(res->Bn(), base->Bn(), exp->Bn(), mont->mod_, ctx, mont->mont_);
+
+  info.GetReturnValue().Set(BigNum::NewInstance(res));
+}
+
+NAN_METHOD(Montgomery::Bmulm)
+{
+  AutoBN_CTX ctx;
+  Montgomery *mont = Nan::ObjectWrap::Unwrap<Montgomery>(info.This());
+
+  BigNum *a = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *b = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = new BigNum();
+
+  // (a*R) * b * R^-1 = a*b, so only one operand needs converting.
+  BN_CTX_start(ctx);
+  BIGNUM *ta = BN_CTX_get(ctx);
+  BIGNUM *tb = BN_CTX_get(ctx);
+  BN_to_montgomery(ta, mont->Reduce(a->Bn(), ta, ctx), mont->mont_, ctx);
+  BN_mod_mul_montgomery(res->Bn(), ta, mont->Reduce(b->Bn(), tb, ctx), mont->mont_, ctx);
+  BN_CTX_end(ctx);
+
+  info.GetReturnValue().Set(BigNum::NewInstance(res));
+}
+
+NAN_METHOD(Montgomery::Bsqrm)
+{
+  AutoBN_CTX ctx;
+  Montgomery *mont = Nan::ObjectWrap::Unwrap<Montgomery>(info.This());
+
+  BigNum *a = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *res = new BigNum();
+
+  BN_CTX_start(ctx);
+  BIGNUM *ra = BN_CTX_get(ctx);
+  BIGNUM *ta = BN_CTX_get(ctx);
+  const BIGNUM *x = mont->Reduce(a->Bn(), ra, ctx);
+  BN_to_montgomery(ta, x, mont->mont_, ctx);
+  BN_mod_mul_montgomery(res->Bn(), ta, x, mont->mont_, ctx);
+  BN_CTX_end(ctx);
 
-  info.GetReturnValue().Set(Nan::New<Number>(BN_is_prime_ex(bignum->bignum_, reps, ctx, NULL)));
+  info.GetReturnValue().Set(BigNum::NewInstance(res));
 }
 
-NAN_METHOD(BigNum::IsBitSet)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+/**
+ * g^e mod m for a fixed g and odd m, with exponents of up to maxBits bits.
+ * The table holds G_i = g^(2^(w*i)) in Montgomery form, and powm evaluates
+ *   g^e = prod_{j = 1}^{2^w - 1} (prod_{digit i of e == j} G_i)^j
+ * by the Brickell-Gordon-McCurley-Wilson method: about maxBits/w + 2^w
+ * multiplications and no squarings, against maxBits squarings for an
+ * ordinary exponentiation. Longer exponents fall back to BN_mod_exp_mont.
+ */
+class FixedBase : public Nan::ObjectWrap {
+public:
+  static void Initialize(Local<Object> target);
 
-  REQ_UINT32_ARG(0, n);
+protected:
+  static Nan::Persistent<FunctionTemplate> constructor_template;
 
-  info.GetReturnValue().Set(Nan::New<Number>(BN_is_bit_set(bignum->bignum_, n)));
-}
+  BIGNUM *base_;
+  BIGNUM *mod_;
+  BN_MONT_CTX *mont_;
+  int window_;
+  int maxBits_;
+  vector<BIGNUM*> table_;
 
-NAN_METHOD(BigNum::Bcompare)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  FixedBase();
+  ~FixedBase();
 
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  static NAN_METHOD(New);
+  static NAN_METHOD(Bpowm);
+};
 
-  info.GetReturnValue().Set(Nan::New<Number>(BN_cmp(bignum->bignum_, bn->bignum_)));
-}
+Nan::Persistent<FunctionTemplate> FixedBase::constructor_template;
 
-NAN_METHOD(BigNum::Scompare)
-{
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+void FixedBase::Initialize(v8::Local<v8::Object> target) {
+  Nan::HandleScope scope;
 
-  REQ_INT64_ARG(0, x);
-  BigNum *bn = new BigNum(x);
-  int res = BN_cmp(bignum->bignum_, bn->bignum_);
+  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
+  constructor_template.Reset(tmpl);
 
-  info.GetReturnValue().Set(Nan::New<Number>(res));
+  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tmpl->SetClassName(Nan::New("FixedBase").ToLocalChecked());
+
+  Nan::SetPrototypeMethod(tmpl, "bpowm", Instrumented<Bpowm>::Register("FixedBase.bpowm"));
+
+  Nan::Set(target, Nan::New("FixedBase").ToLocalChecked(), Nan::GetFunction(tmpl).ToLocalChecked());
 }
 
-NAN_METHOD(BigNum::Ucompare)
+FixedBase::FixedBase() : Nan::ObjectWrap (),
+    base_(BN_new()), mod_(BN_new()), mont_(BN_MONT_CTX_new()),
+    window_(1), maxBits_(0)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+}
 
-  REQ_UINT64_ARG(0, x);
-  int res;
-  if (sizeof(BN_ULONG) >= 8 || x <= 0xFFFFFFFFL) {
-    BIGNUM* bn = BN_new();
-    BN_set_word(bn, x);
-    res = BN_cmp(bignum->bignum_, bn);
-    BN_clear_free(bn);
-  } else {
-    BigNum *bn = new BigNum(x);
-    res = BN_cmp(bignum->bignum_, bn->bignum_);
+FixedBase::~FixedBase()
+{
+  for (size_t i = 0; i < table_.size(); i++) {
+    BN_clear_free(table_[i]);
   }
-
-  info.GetReturnValue().Set(Nan::New<Number>(res));
+  BN_MONT_CTX_free(mont_);
+  BN_clear_free(mod_);
+  BN_clear_free(base_);
 }
 
-// Utility functions from converting OpenSSL's MPI
-// format to two's complement, which is what bitwise
-// operations are expected to work on
-static void
-mpi2twosComplement(uint8_t *bytes, size_t numBytes)
+// Longest exponent, in multiples of the modulus size, a FixedBase table
+// may be built for
+static const int kFixedBaseMaxRatio = 8;
+
+// new FixedBase(g, mod, maxBits)
+NAN_METHOD(FixedBase::New)
 {
-  int i;
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("FixedBase must be called with new");
+    return;
+  }
 
-  bytes[0] &= ~0x80;
-  for (i = 0; i < (int) numBytes; i++) {
-    bytes[i] = ~bytes[i];
+  BigNum *g = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  BigNum *m = Nan::ObjectWrap::Unwrap<BigNum>(info[1]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  REQ_UINT32_ARG(2, maxBits);
+  if (!BN_is_odd(m->Bn()) || BN_is_negative(m->Bn())) {
+    Nan::ThrowRangeError("FixedBase modulus must be a positive odd number");
+    return;
   }
-  for (i = numBytes - 1; i >= 0; i--) {
-    if (bytes[i] == 0xff) {
-      bytes[i] = 0;
-    } else {
-      bytes[i]++;
-      break;
-    }
+  if (maxBits == 0) {
+    Nan::ThrowRangeError("FixedBase exponent size must be at least 1 bit");
+    return;
+  }
+  // The table holds maxBits / w residues, so its size is bounded by the
+  // modulus; the bound also keeps the int arithmetic below from overflowing
+  uint64_t limit = max((uint64_t) kFixedBaseMaxRatio * BN_num_bits(m->Bn()), (uint64_t) 4096);
+  if (maxBits > min(limit, (uint64_t) 1 << 30)) {
+    Nan::ThrowRangeError("FixedBase exponent size must not exceed 8 times the modulus size or 4096 bits");
+    return;
   }
-}
 
-static void
-twos_complement2mpi(uint8_t *bytes, size_t numBytes)
-{
-  int i;
+  AutoBN_CTX ctx;
+  FixedBase *fb = new FixedBase();
+  BN_copy(fb->mod_, m->Bn());
+  if (!BN_MONT_CTX_set(fb->mont_, fb->mod_, ctx)) {
+    delete fb;
+    Nan::ThrowError("Montgomery context setup failed");
+    return;
+  }
+  BN_nnmod(fb->base_, g->Bn(), fb->mod_, ctx);
+
+  // Minimize the multiplications per powm: one per digit plus 2^w
+  int best = 0;
+  for (int w = 1; w <= 16; w++) {
+    int cost = (maxBits + w - 1) / w + (1 << w);
+    if (best == 0 || cost < best) {
+      best = cost;
+      fb->window_ = w;
+    }
+  }
+  fb->maxBits_ = maxBits;
 
-  for (i = numBytes - 1; i >= 0; i--) {
-    if (bytes[i] == 0) {
-      bytes[i] = 0xff;
+  int digits = (maxBits + fb->window_ - 1) / fb->window_;
+  for (int i = 0; i < digits; i++) {
+    BIGNUM *g_i = BN_new();
+    if (i == 0) {
+      BN_to_montgomery(g_i, fb->base_, fb->mont_, ctx);
     } else {
-      bytes[i]--;
-      break;
+      BN_copy(g_i, fb->table_.back());
+      for (int j = 0; j < fb->window_; j++) {
+        BN_mod_mul_montgomery(g_i, g_i, g_i, fb->mont_, ctx);
+      }
     }
+    fb->table_.push_back(g_i);
   }
-  for (i = 0; i < (int) numBytes; i++) {
-    bytes[i] = ~bytes[i];
-  }
-  bytes[0] |= 0x80;
-}
-
-const int BN_PAYLOAD_OFFSET = 4;
 
-// Shifts things around in an OpenSSL MPI buffer so that
-// the sizes of bignum operands match
-static void
-shiftSizeAndMSB(uint8_t *bytes, uint8_t *sizeBuffer, size_t offset)
-{
-  memset(bytes + offset, 0, BN_PAYLOAD_OFFSET);
-  memcpy(bytes, sizeBuffer, BN_PAYLOAD_OFFSET);
+  fb->Wrap(info.This());
 
-  // We've copied the size header over; now we just need to move
-  // the MSB signifying negativity if it's present
-  if(bytes[BN_PAYLOAD_OFFSET + offset] & 0x80) {
-    bytes[BN_PAYLOAD_OFFSET] |= 0x80;
-    bytes[BN_PAYLOAD_OFFSET + offset] &= ~0x80;
-  }
+  info.GetReturnValue().Set(info.This());
 }
 
-static bool
-isMinimumNegativeNumber(uint8_t *bytes, size_t size)
+NAN_METHOD(FixedBase::Bpowm)
 {
-  if (bytes[0] != 0x80) {
-    return false;
+  FixedBase *fb = Nan::ObjectWrap::Unwrap<FixedBase>(info.This());
+  BigNum *e = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+  if (BN_is_negative(e->Bn())) {
+    Nan::ThrowRangeError("Exponent must not be negative");
+    return;
   }
 
-  for (size_t i = 1; i < size; i++) {
-    if (bytes[i] != 0) {
-      return false;
+  AutoBN_CTX ctx;
+  BigNum *res = new BigNum();
+  if (BN_num_bits(e->Bn()) > fb->maxBits_) {
+    mod_exp_mont(res->Bn(), fb->base_, e->Bn(), fb->mod_, ctx, fb->mont_);
+    info.GetReturnValue().Set(BigNum::NewInstance(res));
+    return;
+  }
+
+  vector<unsigned int> digits;
+  exponentDigits(digits, e->Bn(), fb->window_);
+
+  // Visit the nonzero digits from the largest value down
+  vector<pair<unsigned int, int> > order;
+  for (size_t i = 0; i < digits.size(); i++) {
+    if (digits[i] != 0) {
+      order.push_back(make_pair(digits[i], (int) i));
+    }
+  }
+  sort(order.rbegin(), order.rend());
+
+  BN_CTX_start(ctx);
+  BIGNUM *a = BN_CTX_get(ctx);
+  BIGNUM *b = BN_CTX_get(ctx);
+  bool haveA = false, haveB = false;
+  size_t next = 0;
+  for (unsigned int j = order.empty() ? 0 : order[0].first; j >= 1; j--) {
+    // b = prod of G_i with digit i >= j; a = prod over j of b
+    for (; next < order.size() && order[next].first == j; next++) {
+      const BIGNUM *g_i = fb->table_[order[next].second];
+      if (haveB) {
+        BN_mod_mul_montgomery(b, b, g_i, fb->mont_, ctx);
+      } else {
+        BN_copy(b, g_i);
+        haveB = true;
+      }
+    }
+    if (haveA) {
+      BN_mod_mul_montgomery(a, a, b, fb->mont_, ctx);
+    } else {
+      BN_copy(a, b);
+      haveA = true;
     }
   }
 
-  return true;
+  if (haveA) {
+    BN_from_montgomery(res->Bn(), a, fb->mont_, ctx);
+  } else {
+    BN_one(res->Bn());
+    BN_nnmod(res->Bn(), res->Bn(), fb->mod_, ctx);
+  }
+  BN_CTX_end(ctx);
+
+  info.GetReturnValue().Set(BigNum::NewInstance(res));
 }
 
-static void
-swapEndianness(uint8_t *bytes)
+static NAN_METHOD(SetJSConditioner)
 {
-  uint8_t tmp;
+  Nan::HandleScope scope;
 
-  tmp = bytes[0];
-  bytes[0] = bytes[3];
-  bytes[3] = tmp;
+  BigNum::SetJSConditioner(Local<Function>::Cast(info[0]));
 
-  tmp = bytes[1];
-  bytes[1] = bytes[2];
-  bytes[2] = tmp;
+  return;
 }
 
-Local<Value>
-BigNum::Bop(Nan::NAN_METHOD_ARGS_TYPE info, int op)
-{
-  Nan::EscapableHandleScope scope;
+/**
+ * RSA-style private key operation via the Chinese Remainder Theorem. Two
+ * exponentiations with half-size moduli and exponents replace one full-size
+ * one, and the Montgomery contexts for p and q are built once per context.
+ * With two threads the mod q half runs on its own thread.
+ */
+class CrtContext : public Nan::ObjectWrap {
+public:
+  static void Initialize(Local<Object> target);
 
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+protected:
+  static Nan::Persistent<FunctionTemplate> constructor_template;
 
-  bool bignumNegative = BN_is_negative(bignum->bignum_);
-  bool bnNegative = BN_is_negative(bn->bignum_);
+  BIGNUM *p_;
+  BIGNUM *q_;
+  BIGNUM *dp_;
+  BIGNUM *dq_;
+  BIGNUM *qinv_;
+  BN_MONT_CTX *montP_;
+  BN_MONT_CTX *montQ_;
+  bool parallel_;
 
-  BigNum *res = new BigNum();
+  CrtContext();
+  ~CrtContext();
+
+  // One of the two exponentiations, r = c^d mod m with c reduced first
+  struct Half
+  {
+    BIGNUM *r;
+    const BIGNUM *c;
+    const BIGNUM *d;
+    const BIGNUM *m;
+    BN_MONT_CTX *mont;
+    int ok;
+  };
 
-  // Modified from https://github.com/Worlize/WebSocket-Node/blob/master/src/xor.cpp
-  // Portions Copyright (c) Agora S.A.
-  // Licensed under the MIT License.
+  // Takes a Half, so that it can also be a uv_thread_create entry point
+  static void HalfPowm(void *arg);
 
-  int payloadSize = BN_bn2mpi(bignum->bignum_, NULL);
-  int maskSize = BN_bn2mpi(bn->bignum_, NULL);
+  static NAN_METHOD(New);
+  static NAN_METHOD(Bpowm);
+};
 
-  uint32_t size = max(payloadSize, maskSize);
-  int offset = abs(payloadSize - maskSize);
+Nan::Persistent<FunctionTemplate> CrtContext::constructor_template;
 
-  int payloadOffset = 0;
-  int maskOffset = 0;
+// Smallest primes for which threads: 2 splits a powm. Each half of a
+// 2048-bit key takes ~400us, against ~20us to start and join a thread.
+static const int kCrtParallelBits = 1024;
 
-  if (payloadSize < maskSize) {
-    payloadOffset = offset;
-  } else if (payloadSize > maskSize) {
-    maskOffset = offset;
-  }
+void CrtContext::Initialize(v8::Local<v8::Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
+  constructor_template.Reset(tmpl);
 
-  uint8_t* payload = (uint8_t*) calloc(size, sizeof(char));
-  uint8_t* mask = (uint8_t*) calloc(size, sizeof(char));
+  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tmpl->SetClassName(Nan::New("CrtContext").ToLocalChecked());
 
-  BN_bn2mpi(bignum->bignum_, payload + payloadOffset);
-  BN_bn2mpi(bn->bignum_, mask + maskOffset);
+  Nan::SetPrototypeMethod(tmpl, "bpowm", Instrumented<Bpowm>::Register("CrtContext.bpowm"));
 
-  if (payloadSize < maskSize) {
-    shiftSizeAndMSB(payload, mask, payloadOffset);
-  } else {
-    shiftSizeAndMSB(mask, payload, maskOffset);
-  }
+  Nan::Set(target, Nan::New("CrtContext").ToLocalChecked(), Nan::GetFunction(tmpl).ToLocalChecked());
+}
 
-  payload += BN_PAYLOAD_OFFSET;
-  mask += BN_PAYLOAD_OFFSET;
-  size -= BN_PAYLOAD_OFFSET;
+CrtContext::CrtContext() : Nan::ObjectWrap (),
+    p_(BN_new()), q_(BN_new()), dp_(BN_new()), dq_(BN_new()), qinv_(BN_new()),
+    montP_(BN_MONT_CTX_new()), montQ_(BN_MONT_CTX_new()), parallel_(false)
+{
+}
 
-  if(bignumNegative) {
-    mpi2twosComplement(payload, size);
-  }
-  if(bnNegative) {
-    mpi2twosComplement(mask, size);
+CrtContext::~CrtContext()
+{
+  BN_MONT_CTX_free(montP_);
+  BN_MONT_CTX_free(montQ_);
+  BN_clear_free(qinv_);
+  BN_clear_free(dq_);
+  BN_clear_free(dp_);
+  BN_clear_free(q_);
+  BN_clear_free(p_);
+}
+
+void CrtContext::HalfPowm(void *arg)
+{
+  Half *h = static_cast<Half*>(arg);
+  AutoBN_CTX ctx;
+  BN_CTX_start(ctx);
+  BIGNUM *cm = BN_CTX_get(ctx);
+  h->ok = cm != NULL && BN_nnmod(cm, h->c, h->m, ctx) &&
+    BN_mod_exp_mont_consttime(h->r, cm, h->d, h->m, ctx, h->mont);
+  BN_CTX_end(ctx);
+}
+
+// new CrtContext(p, q, dp, dq, qinv, threads)
+NAN_METHOD(CrtContext::New)
+{
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("CrtContext must be called with new");
+    return;
   }
 
-  uint32_t* pos32 = (uint32_t*) payload;
-  uint32_t* end32 = pos32 + (size / 4);
-  uint32_t* mask32 = (uint32_t*) mask;
+  BIGNUM *key[5];
+  for (int i = 0; i < 5; i++) {
+    key[i] = Nan::ObjectWrap::Unwrap<BigNum>(info[i]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked())->Bn();
+  }
+  REQ_UINT32_ARG(5, threads);
+  for (int i = 0; i < 2; i++) {
+    if (!BN_is_odd(key[i]) || BN_is_negative(key[i]) || BN_is_one(key[i])) {
+      Nan::ThrowRangeError("CRT primes must be odd numbers greater than 1");
+      return;
+    }
+  }
+  for (int i = 2; i < 5; i++) {
+    if (BN_is_negative(key[i])) {
+      Nan::ThrowRangeError("CRT exponents and coefficient must not be negative");
+      return;
+    }
+  }
 
-  switch (op) {
-    case 0: while (pos32 < end32) *(pos32++) &= *(mask32++); break;
-    case 1: while (pos32 < end32) *(pos32++) |= *(mask32++); break;
-    case 2: while (pos32 < end32) *(pos32++) ^= *(mask32++); break;
+  AutoBN_CTX ctx;
+  CrtContext *crt = new CrtContext();
+  BN_copy(crt->p_, key[0]);
+  BN_copy(crt->q_, key[1]);
+  BN_copy(crt->dp_, key[2]);
+  BN_copy(crt->dq_, key[3]);
+  BN_copy(crt->qinv_, key[4]);
+  if (!BN_MONT_CTX_set(crt->montP_, crt->p_, ctx) ||
+      !BN_MONT_CTX_set(crt->montQ_, crt->q_, ctx)) {
+    delete crt;
+    Nan::ThrowError("Montgomery context setup failed");
+    return;
   }
+  // Starting a thread costs a few tens of microseconds, so a call is only
+  // split when each half takes long enough to hide that and there is a
+  // second core to run it on
+  crt->parallel_ = threads > 1 && thread::hardware_concurrency() > 1 &&
+    BN_num_bits(crt->p_) >= kCrtParallelBits && BN_num_bits(crt->q_) >= kCrtParallelBits;
 
-  uint8_t* pos8 = (uint8_t*) pos32;
-  uint8_t* end8 = payload + size;
-  uint8_t* mask8 = (uint8_t*) mask32;
+  crt->Wrap(info.This());
 
-  switch (op) {
-    case 0: while (pos8 < end8) *(pos8++) &= *(mask8++); break;
-    case 1: while (pos8 < end8) *(pos8++) |= *(mask8++); break;
-    case 2: while (pos8 < end8) *(pos8++) ^= *(mask8++); break;
+  info.GetReturnValue().Set(info.This());
+}
+
+// bpowm(c): m1 = c^dp mod p, m2 = c^dq mod q, m = m2 + q * (qinv * (m1 - m2) mod p)
+NAN_METHOD(CrtContext::Bpowm)
+{
+  CrtContext *crt = Nan::ObjectWrap::Unwrap<CrtContext>(info.This());
+  BigNum *c = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
+
+  AutoBN_CTX ctx;
+  BN_CTX_start(ctx);
+  BIGNUM *m1 = BN_CTX_get(ctx);
+  BIGNUM *m2 = BN_CTX_get(ctx);
+  BIGNUM *h = BN_CTX_get(ctx);
+
+  // Materialized here, as Bn() must not run on the helper thread
+  const BIGNUM *cb = c->Bn();
+
+  Half hp = { m1, cb, crt->dp_, crt->p_, crt->montP_, 0 };
+  Half hq = { m2, cb, crt->dq_, crt->q_, crt->montQ_, 0 };
+  uv_thread_t half;
+  // If no thread can be started both halves run here instead
+  if (crt->parallel_ && uv_thread_create(&half, HalfPowm, &hq) == 0) {
+    HalfPowm(&hp);
+    uv_thread_join(&half);
+  } else {
+    HalfPowm(&hp);
+    HalfPowm(&hq);
+  }
+
+  BigNum *res = new BigNum();
+  bool ok = hp.ok && hq.ok &&
+    BN_mod_sub(h, m1, m2, crt->p_, ctx) &&
+    BN_mod_mul(h, h, crt->qinv_, crt->p_, ctx) &&
+    BN_mul(h, h, crt->q_, ctx) &&
+    BN_add(res->Bn(), m2, h);
+  BN_CTX_end(ctx);
+
+  if (!ok) {
+    delete res;
+    Nan::ThrowError("CRT exponentiation failed");
+    return;
   }
 
-  payload -= BN_PAYLOAD_OFFSET;
-  mask -= BN_PAYLOAD_OFFSET;
-  size += BN_PAYLOAD_OFFSET;
+  info.GetReturnValue().Set(BigNum::NewInstance(res));
+}
 
-  // If the value is the largest negative number representible by
-  // size bytes, we need to add another byte to the payload buffer,
-  // otherwise OpenSSL's BN_mpi2bn will interpret the number as -0
-  if (isMinimumNegativeNumber(payload + BN_PAYLOAD_OFFSET, size - BN_PAYLOAD_OFFSET)) {
-    bool bigEndian = (size - BN_PAYLOAD_OFFSET) == *((uint32_t *) payload);
+/**
+ * Arithmetic modulo an odd p with elements kept in Montgomery form aR mod p.
+ * Products are a single BN_mod_mul_montgomery and sums never leave [0, p),
+ * so chained field operations need no division. The JS side wraps the
+ * residues; they only become ordinary values again through Bfrom.
+ */
+class Field : public Nan::ObjectWrap {
+public:
+  static void Initialize(Local<Object> target);
 
-    uint8_t *newPayload = (uint8_t *) calloc(size + 1, 1);
+protected:
+  static Nan::Persistent<FunctionTemplate> constructor_template;
 
-    memcpy(newPayload + 5, payload + BN_PAYLOAD_OFFSET, size - BN_PAYLOAD_OFFSET);
-    newPayload[BN_PAYLOAD_OFFSET] = 0x80;
-    size++;
+  BIGNUM *p_;
+  BN_MONT_CTX *mont_;
+  // R^3 mod p: turns BN_mod_inverse(aR) = a^-1 R^-1 into a^-1 R
+  BIGNUM *r3_;
 
-    size -= BN_PAYLOAD_OFFSET;
-    memcpy(newPayload, &size, BN_PAYLOAD_OFFSET);
-    size += BN_PAYLOAD_OFFSET;
+  Field();
+  ~Field();
 
-    if (!bigEndian) {
-      swapEndianness(newPayload);
-    }
+  static BIGNUM* Operand(Nan::NAN_METHOD_ARGS_TYPE info, int i);
 
-    free(payload);
-    payload = newPayload;
-  } else if(payload[BN_PAYLOAD_OFFSET] & 0x80) {
-    twos_complement2mpi(payload + BN_PAYLOAD_OFFSET, size - BN_PAYLOAD_OFFSET);
-  }
+  static NAN_METHOD(New);
+  static NAN_METHOD(Bto);
+  static NAN_METHOD(Bfrom);
+  static NAN_METHOD(Baddm);
+  static NAN_METHOD(Bsubm);
+  static NAN_METHOD(Bmulm);
+  static NAN_METHOD(Bsqrm);
+  static NAN_METHOD(Bnegm);
+  static NAN_METHOD(Binvm);
+  static NAN_METHOD(Bpowm);
+};
 
-  BN_mpi2bn(payload, size, res->bignum_);
+Nan::Persistent<FunctionTemplate> Field::constructor_template;
 
-  WRAP_RESULT(res, result);
+void Field::Initialize(v8::Local<v8::Object> target) {
+  Nan::HandleScope scope;
 
-  free(payload);
-  free(mask);
+  Local<FunctionTemplate> tmpl = Nan::New<FunctionTemplate>(New);
+  constructor_template.Reset(tmpl);
 
-  return scope.Escape(result);
+  tmpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tmpl->SetClassName(Nan::New("Field").ToLocalChecked());
+
+  Nan::SetPrototypeMethod(tmpl, "bto", Instrumented<Bto>::Register("Field.bto"));
+  Nan::SetPrototypeMethod(tmpl, "bfrom", Instrumented<Bfrom>::Register("Field.bfrom"));
+  Nan::SetPrototypeMethod(tmpl, "baddm", Instrumented<Baddm>::Register("Field.baddm"));
+  Nan::SetPrototypeMethod(tmpl, "bsubm", Instrumented<Bsubm>::Register("Field.bsubm"));
+  Nan::SetPrototypeMethod(tmpl, "bmulm", Instrumented<Bmulm>::Register("Field.bmulm"));
+  Nan::SetPrototypeMethod(tmpl, "bsqrm", Instrumented<Bsqrm>::Register("Field.bsqrm"));
+  Nan::SetPrototypeMethod(tmpl, "bnegm", Instrumented<Bnegm>::Register("Field.bnegm"));
+  Nan::SetPrototypeMethod(tmpl, "binvm", Instrumented<Binvm>::Register("Field.binvm"));
+  Nan::SetPrototypeMethod(tmpl, "bpowm", Instrumented<Bpowm>::Register("Field.bpowm"));
+
+  Nan::Set(target, Nan::New("Field").ToLocalChecked(), Nan::GetFunction(tmpl).ToLocalChecked());
 }
 
-NAN_METHOD(BigNum::Band)
+Field::Field() : Nan::ObjectWrap (),
+    p_(BN_new()), mont_(BN_MONT_CTX_new()), r3_(BN_new())
 {
-  info.GetReturnValue().Set(Bop(info, 0));
 }
 
-NAN_METHOD(BigNum::Bor)
+Field::~Field()
 {
-  info.GetReturnValue().Set(Bop(info, 1));
+  BN_clear_free(r3_);
+  BN_MONT_CTX_free(mont_);
+  BN_clear_free(p_);
 }
 
-NAN_METHOD(BigNum::Bxor)
+BIGNUM* Field::Operand(Nan::NAN_METHOD_ARGS_TYPE info, int i)
 {
-  info.GetReturnValue().Set(Bop(info, 2));
+  return Nan::ObjectWrap::Unwrap<BigNum>(info[i]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked())->Bn();
 }
 
-NAN_METHOD(BigNum::Binvertm)
+// new Field(p)
+NAN_METHOD(Field::New)
 {
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("Field must be called with new");
+    return;
+  }
+
+  BIGNUM *p = Operand(info, 0);
+  if (!BN_is_odd(p) || BN_is_negative(p) || BN_is_one(p)) {
+    Nan::ThrowRangeError("Field modulus must be an odd number greater than 1");
+    return;
+  }
+
   AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  Field *field = new Field();
+  BN_copy(field->p_, p);
+  if (!BN_MONT_CTX_set(field->mont_, field->p_, ctx)) {
+    delete field;
+    Nan::ThrowError("Montgomery context setup failed");
+    return;
+  }
+  // R^2 in Montgomery form is R^3
+  BN_one(field->r3_);
+  BN_to_montgomery(field->r3_, field->r3_, field->mont_, ctx);
+  BN_to_montgomery(field->r3_, field->r3_, field->mont_, ctx);
+  BN_to_montgomery(field->r3_, field->r3_, field->mont_, ctx);
 
-  BigNum *bn = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
-  BN_mod_inverse(res->bignum_, bignum->bignum_, bn->bignum_, ctx);
+  field->Wrap(info.This());
 
-  WRAP_RESULT(res, result);
+  info.GetReturnValue().Set(info.This());
+}
 
-  info.GetReturnValue().Set(result);
+// bto(x, out): x mod p into Montgomery form
+NAN_METHOD(Field::Bto)
+{
+  AutoBN_CTX ctx;
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
+
+  BigNum *res = BigNum::OutArg(info, 1);
+  BN_nnmod(res->Bn(), Operand(info, 0), field->p_, ctx);
+  BN_to_montgomery(res->Bn(), res->Bn(), field->mont_, ctx);
+
+  BigNum::ReturnResult(info, 1, res);
 }
 
-NAN_METHOD(BigNum::Bsqrt)
+NAN_METHOD(Field::Bfrom)
 {
-  Nan::ThrowError("sqrt is not supported by OpenSSL.");
+  AutoBN_CTX ctx;
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
+
+  BigNum *res = new BigNum();
+  BN_from_montgomery(res->Bn(), Operand(info, 0), field->mont_, ctx);
+
+  info.GetReturnValue().Set(BigNum::NewInstance(res));
 }
 
-NAN_METHOD(BigNum::Broot)
+NAN_METHOD(Field::Baddm)
 {
-  Nan::ThrowError("root is not supported by OpenSSL.");
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
+
+  BigNum *res = BigNum::OutArg(info, 2);
+  BN_mod_add_quick(res->Bn(), Operand(info, 0), Operand(info, 1), field->p_);
+
+  BigNum::ReturnResult(info, 2, res);
 }
 
-NAN_METHOD(BigNum::BitLength)
+NAN_METHOD(Field::Bsubm)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
 
-  int size = BN_num_bits(bignum->bignum_);
-  Local<Value> result = Nan::New<Integer>(size);
+  BigNum *res = BigNum::OutArg(info, 2);
+  BN_mod_sub_quick(res->Bn(), Operand(info, 0), Operand(info, 1), field->p_);
 
-  info.GetReturnValue().Set(result);
+  BigNum::ReturnResult(info, 2, res);
 }
 
-NAN_METHOD(BigNum::Bgcd)
+NAN_METHOD(Field::Bmulm)
 {
   AutoBN_CTX ctx;
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *bi = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  BigNum *res = new BigNum();
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
 
-  BN_gcd(res->bignum_, bignum->bignum_, bi->bignum_, ctx);
+  BigNum *res = BigNum::OutArg(info, 2);
+  BN_mod_mul_montgomery(res->Bn(), Operand(info, 0), Operand(info, 1), field->mont_, ctx);
 
-  WRAP_RESULT(res, result);
-  info.GetReturnValue().Set(result);
+  BigNum::ReturnResult(info, 2, res);
 }
 
-NAN_METHOD(BigNum::Bjacobi)
+NAN_METHOD(Field::Bsqrm)
 {
   AutoBN_CTX ctx;
-  BigNum *bn_a = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
-
-  BigNum *bn_n = Nan::ObjectWrap::Unwrap<BigNum>(info[0]->ToObject(info.GetIsolate()->GetCurrentContext()).ToLocalChecked());
-  int res = 0;
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
 
-  if (BN_jacobi_priv(bn_a->bignum_, bn_n->bignum_, &res, ctx) == -1) {
-    Nan::ThrowError("Jacobi symbol calculation failed");
-    return;
-  }
+  BIGNUM *a = Operand(info, 0);
+  BigNum *res = BigNum::OutArg(info, 1);
+  BN_mod_mul_montgomery(res->Bn(), a, a, field->mont_, ctx);
 
-  info.GetReturnValue().Set(Nan::New<Integer>(res));
+  BigNum::ReturnResult(info, 1, res);
 }
 
-NAN_METHOD(BigNum::Bsetcompact)
+NAN_METHOD(Field::Bnegm)
 {
-  BigNum *bignum = Nan::ObjectWrap::Unwrap<BigNum>(info.This());
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
 
-  unsigned int nCompact = Nan::To<uint32_t>(info[0]).FromJust();
-  unsigned int nSize = nCompact >> 24;
-  bool fNegative     =(nCompact & 0x00800000) != 0;
-  unsigned int nWord = nCompact & 0x007fffff;
-  if (nSize <= 3)
-  {
-      nWord >>= 8*(3-nSize);
-      BN_set_word(bignum->bignum_, nWord);
+  BIGNUM *a = Operand(info, 0);
+  BigNum *res = BigNum::OutArg(info, 1);
+  if (BN_is_zero(a)) {
+    BN_zero(res->Bn());
+  } else {
+    BN_sub(res->Bn(), field->p_, a);
   }
-  else
-  {
-      BN_set_word(bignum->bignum_, nWord);
-      BN_lshift(bignum->bignum_, bignum->bignum_, 8*(nSize-3));
+
+  BigNum::ReturnResult(info, 1, res);
+}
+
+NAN_METHOD(Field::Binvm)
+{
+  AutoBN_CTX ctx;
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
+
+  BIGNUM *a = Operand(info, 0);
+  BN_CTX_start(ctx);
+  BIGNUM *t = BN_CTX_get(ctx);
+  bool ok = t != NULL && BN_mod_inverse(t, a, field->p_, ctx) != NULL;
+  if (!ok) {
+    BN_CTX_end(ctx);
+    ERR_clear_error();
+    Nan::ThrowRangeError("Element is not invertible");
+    return;
   }
-  BN_set_negative(bignum->bignum_, fNegative);
 
-  info.GetReturnValue().Set(info.This());
+  BigNum *res = BigNum::OutArg(info, 1);
+  BN_mod_mul_montgomery(res->Bn(), t, field->r3_, field->mont_, ctx);
+  BN_CTX_end(ctx);
+
+  BigNum::ReturnResult(info, 1, res);
 }
 
-static NAN_METHOD(SetJSConditioner)
+// bpowm(a, e, out): e is an ordinary value and must not be negative
+NAN_METHOD(Field::Bpowm)
 {
-  Nan::HandleScope scope;
+  AutoBN_CTX ctx;
+  Field *field = Nan::ObjectWrap::Unwrap<Field>(info.This());
 
-  BigNum::SetJSConditioner(Local<Function>::Cast(info[0]));
+  BIGNUM *a = Operand(info, 0);
+  BIGNUM *e = Operand(info, 1);
+  if (BN_is_negative(e)) {
+    Nan::ThrowRangeError("Exponent must not be negative");
+    return;
+  }
 
-  return;
+  BigNum *res = BigNum::OutArg(info, 2);
+  BN_CTX_start(ctx);
+  BIGNUM *t = BN_CTX_get(ctx);
+  BN_from_montgomery(t, a, field->mont_, ctx);
+  mod_exp_mont(t, t, e, field->p_, ctx, field->mont_);
+  BN_to_montgomery(res->Bn(), t, field->mont_, ctx);
+  BN_CTX_end(ctx);
+
+  BigNum::ReturnResult(info, 2, res);
 }
 
 extern "C" void
@@ -1128,6 +5814,11 @@ init (Local<Object> target)
   Nan::HandleScope scope;
 
   BigNum::Initialize(target);
+  CancelToken::Initialize(target);
+  Montgomery::Initialize(target);
+  FixedBase::Initialize(target);
+  CrtContext::Initialize(target);
+  Field::Initialize(target);
   Nan::SetMethod(target, "setJSConditioner", SetJSConditioner);
 }
 
@@ -1,5 +1,6 @@
 var bin = require('bindings')('bignum')
 var Buffer = require('safe-buffer').Buffer
+var os = require('os')
 var BigNum = bin.BigNum
 
 module.exports = BigNum
@@ -41,6 +42,12 @@ BigNum.conditionArgs = function (num, base) {
 
 bin.setJSConditioner(BigNum.conditionArgs)
 
+// Per-method counters (see BigNum.stats()) can be switched on from the
+// environment, so production processes need no code change
+if (process.env.BIGNUM_STATS) {
+  BigNum.enableStats()
+}
+
 BigNum.isBigNum = function (num) {
   if (!num) {
     return false
@@ -70,80 +77,204 @@ BigNum.prototype.toString = function (base) {
   return value
 }
 
-BigNum.prototype.toNumber = function () {
-  return parseInt(this.toString(), 10)
-}
-
-;['add', 'sub', 'mul', 'div', 'mod'].forEach(function (op) {
-  BigNum.prototype[op] = function (num) {
-    var x
-    if (BigNum.isBigNum(num)) {
-      return this['b' + op](num)
-    } else if (typeof num === 'number') {
-      if (num >= 0) {
-        return this['u' + op](num)
-      } else if (op === 'add') {
-        return this.usub(-num)
-      } else if (op === 'sub') {
-        return this.uadd(-num)
-      } else {
-        x = BigNum(num)
-        return this['b' + op](x)
-      }
-    } else if (typeof num === 'string') {
-      x = BigNum(num)
-      return this['b' + op](x)
-    } else {
-      throw new TypeError('Unspecified operation for type ' +
-        (typeof num) + ' for ' + op)
-    }
-  }
-})
+// add, sub, mul, div, mod and cmp, with their in-place iadd ... imod
+// variants, are native: they type-check the operand and take word-sized
+// numbers without allocating.
 
 BigNum.prototype.abs = function () {
   return this.babs()
 }
 
+BigNum.prototype.iabs = function (out) {
+  return this.babs(out || this)
+}
+
 BigNum.prototype.neg = function () {
   return this.bneg()
 }
 
-BigNum.prototype.powm = function (num, mod) {
+BigNum.prototype.ineg = function (out) {
+  return this.bneg(out || this)
+}
+
+function powm (self, num, mod, out) {
   var m
 
   if ((typeof mod) === 'number' || (typeof mod) === 'string') {
     m = BigNum(mod)
-  } else if (BigNum.isBigNum(mod)) {
+  } else if (mod instanceof BigNum || BigNum.isBigNum(mod)) {
     m = mod
   }
 
   if ((typeof num) === 'number') {
-    return this.upowm(num, m)
+    return self.upowm(num, m, out)
   } else if ((typeof num) === 'string') {
     var n = BigNum(num)
-    return this.bpowm(n, m)
-  } else if (BigNum.isBigNum(num)) {
-    return this.bpowm(num, m)
+    return self.bpowm(n, m, out)
+  } else if (num instanceof BigNum || BigNum.isBigNum(num)) {
+    return self.bpowm(num, m, out)
   }
 }
 
-BigNum.prototype.mod = function (num, mod) {
-  var m
+BigNum.prototype.powm = function (num, mod) {
+  return powm(this, num, mod)
+}
 
-  if ((typeof mod) === 'number' || (typeof mod) === 'string') {
-    m = BigNum(mod)
-  } else if (BigNum.isBigNum(mod)) {
-    m = mod
+BigNum.prototype.ipowm = function (num, mod, out) {
+  return powm(this, num, mod, out || this)
+}
+
+var Montgomery = bin.Montgomery
+
+BigNum.montgomery = function (mod) {
+  return new Montgomery(toBigNum(mod))
+}
+
+Montgomery.prototype.powm = function (base, exp) {
+  return this.bpowm(
+    toBigNum(base),
+    toBigNum(exp)
+  )
+}
+
+Montgomery.prototype.mulm = function (a, b) {
+  return this.bmulm(
+    toBigNum(a),
+    toBigNum(b)
+  )
+}
+
+Montgomery.prototype.sqrm = function (a) {
+  return this.bsqrm(toBigNum(a))
+}
+
+var FixedBase = bin.FixedBase
+
+BigNum.fixedBase = function (base, mod, maxExpBits) {
+  mod = toBigNum(mod)
+  return new FixedBase(
+    toBigNum(base),
+    mod,
+    maxExpBits === undefined ? mod.bitLength() : maxExpBits
+  )
+}
+
+FixedBase.prototype.powm = function (exp) {
+  return this.bpowm(toBigNum(exp))
+}
+
+var CrtContext = bin.CrtContext
+
+BigNum.crtContext = function (key, opts) {
+  var parts = ['p', 'q', 'dp', 'dq', 'qinv'].map(function (name) {
+    if (key[name] === undefined) {
+      throw new TypeError('CRT key is missing ' + name)
+    }
+    return toBigNum(key[name])
+  })
+  var threads = (opts && opts.threads) >>> 0
+  return new CrtContext(parts[0], parts[1], parts[2], parts[3], parts[4], threads)
+}
+
+CrtContext.prototype.powm = function (base) {
+  return this.bpowm(toBigNum(base))
+}
+
+BigNum.crtPowm = function (base, key, opts) {
+  return BigNum.crtContext(key, opts).powm(base)
+}
+
+var Field = bin.Field
+
+// instanceof settles the common case; isBigNum, which walks the whole
+// prototype, only runs for values from another copy of the module
+function toBigNum (x) {
+  return x instanceof BigNum || BigNum.isBigNum(x) ? x : BigNum(x)
+}
+
+BigNum.field = function (p) {
+  return new Field(toBigNum(p))
+}
+
+Field.prototype.element = function (x) {
+  return new FieldElement(this, this.bto(toBigNum(x)))
+}
+
+Field.prototype.zero = function () {
+  return this.element(0)
+}
+
+Field.prototype.one = function () {
+  return this.element(1)
+}
+
+// `mont` holds the Montgomery residue x*R mod p, not the element's value;
+// toBigNum() converts back.
+function FieldElement (field, mont) {
+  this.field = field
+  this.mont = mont
+}
+
+function fieldOperand (self, x) {
+  if (x instanceof FieldElement) {
+    if (x.field !== self.field) {
+      throw new TypeError('Field elements belong to different fields')
+    }
+    return x.mont
   }
+  return self.field.bto(toBigNum(x))
+}
 
-  if ((typeof num) === 'number') {
-    return this.umod(num, m)
-  } else if ((typeof num) === 'string') {
-    var n = BigNum(num)
-    return this.bmod(n, m)
-  } else if (BigNum.isBigNum(num)) {
-    return this.bmod(num, m)
+;['addm', 'subm', 'mulm'].forEach(function (name) {
+  FieldElement.prototype[name] = function (x) {
+    return new FieldElement(this.field, this.field['b' + name](this.mont, fieldOperand(this, x)))
   }
+
+  FieldElement.prototype['i' + name] = function (x) {
+    this.field['b' + name](this.mont, fieldOperand(this, x), this.mont)
+    return this
+  }
+})
+
+;['sqrm', 'negm', 'invm'].forEach(function (name) {
+  FieldElement.prototype[name] = function () {
+    return new FieldElement(this.field, this.field['b' + name](this.mont))
+  }
+
+  FieldElement.prototype['i' + name] = function () {
+    this.field['b' + name](this.mont, this.mont)
+    return this
+  }
+})
+
+FieldElement.prototype.powm = function (e) {
+  return new FieldElement(this.field, this.field.bpowm(this.mont, toBigNum(e)))
+}
+
+FieldElement.prototype.ipowm = function (e) {
+  this.field.bpowm(this.mont, toBigNum(e), this.mont)
+  return this
+}
+
+// Residues are unique in [0, p), so comparing them compares the values
+FieldElement.prototype.eq = function (x) {
+  return this.mont.bcompare(fieldOperand(this, x)) === 0
+}
+
+FieldElement.prototype.isZero = function () {
+  return this.mont.bitLength() === 0
+}
+
+FieldElement.prototype.toBigNum = function () {
+  return this.field.bfrom(this.mont)
+}
+
+FieldElement.prototype.toString = function (base) {
+  return this.toBigNum().toString(base)
+}
+
+BigNum.multiPowm = function (pairs, mod) {
+  return BigNum.bmultipowm(pairs, toBigNum(mod))
 }
 
 BigNum.prototype.pow = function (num) {
@@ -159,45 +290,34 @@ BigNum.prototype.pow = function (num) {
   }
 }
 
-BigNum.prototype.shiftLeft = function (num) {
-  if (typeof num === 'number') {
-    if (num >= 0) {
-      return this.umul2exp(num)
-    } else {
-      return this.shiftRight(-num)
-    }
+function shift (self, num, right, out) {
+  if (typeof num !== 'number') {
+    num = parseInt(num.toString(), 10)
+  }
+  if (right) {
+    num = -num
+  }
+  if (num >= 0) {
+    return self.umul2exp(num, out)
   } else {
-    var x = parseInt(num.toString(), 10)
-    return BigNum.prototype.shiftLeft.call(this, x)
+    return self.udiv2exp(-num, out)
   }
 }
 
+BigNum.prototype.shiftLeft = function (num) {
+  return shift(this, num, false)
+}
+
+BigNum.prototype.ishiftLeft = function (num, out) {
+  return shift(this, num, false, out || this)
+}
+
 BigNum.prototype.shiftRight = function (num) {
-  if (typeof num === 'number') {
-    if (num >= 0) {
-      return this.udiv2exp(num)
-    } else {
-      return this.shiftLeft(-num)
-    }
-  } else {
-    var x = parseInt(num.toString(), 10)
-    return BigNum.prototype.shiftRight.call(this, x)
-  }
+  return shift(this, num, true)
 }
 
-BigNum.prototype.cmp = function (num) {
-  if (BigNum.isBigNum(num)) {
-    return this.bcompare(num)
-  } else if (typeof num === 'number') {
-    if (num < 0) {
-      return this.scompare(num)
-    } else {
-      return this.ucompare(num)
-    }
-  } else {
-    var x = BigNum(num)
-    return this.bcompare(x)
-  }
+BigNum.prototype.ishiftRight = function (num, out) {
+  return shift(this, num, true, out || this)
 }
 
 BigNum.prototype.gt = function (num) {
@@ -224,27 +344,117 @@ BigNum.prototype.le = function (num) {
   return this.cmp(num) <= 0
 }
 
-'and or xor'.split(' ').forEach(function (name) {
+'and or xor andNot'.split(' ').forEach(function (name) {
+  var native = 'b' + name.toLowerCase()
+
   BigNum.prototype[name] = function (num) {
-    if (BigNum.isBigNum(num)) {
-      return this['b' + name](num)
-    } else {
-      var x = BigNum(num)
-      return this['b' + name](x)
-    }
+    return this[native](toBigNum(num))
+  }
+
+  BigNum.prototype['i' + name] = function (num, out) {
+    var x = toBigNum(num)
+    return this[native](x, out || this)
   }
 })
 
+BigNum.prototype.not = function () {
+  return this.bnot()
+}
+
+BigNum.prototype.inot = function (out) {
+  return this.bnot(out || this)
+}
+
+'setBit clearBit maskBits'.split(' ').forEach(function (name) {
+  var native = 'b' + name.toLowerCase()
+
+  BigNum.prototype[name] = function (n) {
+    return this[native](n)
+  }
+
+  BigNum.prototype['i' + name] = function (n, out) {
+    return this[native](n, out || this)
+  }
+})
+
+BigNum.prototype.popcount = function () {
+  return this.bpopcount()
+}
+
 BigNum.prototype.sqrt = function () {
   return this.bsqrt()
 }
 
+// isqrt and iroot are the usual names for integer roots, so unlike the
+// other i-prefixed methods they return a new value; the in-place forms are
+// sqrtInPlace and rootInPlace
+BigNum.prototype.isqrt = BigNum.prototype.sqrt
+
+BigNum.prototype.sqrtInPlace = function (out) {
+  return this.bsqrt(out || this)
+}
+
+BigNum.prototype.sqrtRem = function () {
+  return this.bsqrtrem()
+}
+
+// Rounding modes of divmod; the values match DivmodMode in bignum.cc
+var DIVMOD_MODES = { trunc: 0, floor: 1, euclid: 2 }
+
+BigNum.prototype.divmod = function (num, mode) {
+  if (mode === undefined) mode = 'trunc'
+  if (!Object.prototype.hasOwnProperty.call(DIVMOD_MODES, mode)) {
+    throw new TypeError('Unknown divmod mode ' + mode)
+  }
+  return this.bdivmod(toBigNum(num), DIVMOD_MODES[mode])
+}
+
+BigNum.prototype.mulAdd = function (num, add) {
+  return this.bmuladd(toBigNum(num), toBigNum(add))
+}
+
+BigNum.prototype.imulAdd = function (num, add, out) {
+  return this.bmuladd(toBigNum(num), toBigNum(add), out || this)
+}
+
+;['mulMod', 'addMod', 'subMod'].forEach(function (name) {
+  var native = 'b' + name.toLowerCase()
+
+  BigNum.prototype[name] = function (num, mod) {
+    return this[native](toBigNum(num), toBigNum(mod))
+  }
+
+  BigNum.prototype['i' + name] = function (num, mod, out) {
+    return this[native](toBigNum(num), toBigNum(mod), out || this)
+  }
+})
+
+BigNum.prototype.sqr = function () {
+  return this.bsqr()
+}
+
+BigNum.prototype.isqr = function (out) {
+  return this.bsqr(out || this)
+}
+
 BigNum.prototype.root = function (num) {
-  if (BigNum.isBigNum(num)) {
-    return this.broot(num)
-  } else {
-    return this.broot(num)
+  if (typeof num !== 'number') {
+    num = parseInt(num.toString(), 10)
   }
+  return this.broot(num)
+}
+
+BigNum.prototype.iroot = BigNum.prototype.root
+
+BigNum.prototype.rootInPlace = function (num, out) {
+  if (typeof num !== 'number') {
+    num = parseInt(num.toString(), 10)
+  }
+  return this.broot(num, out || this)
+}
+
+BigNum.prototype.isPerfectPower = function () {
+  return this.bisperfectpower()
 }
 
 BigNum.prototype.rand = function (to) {
@@ -255,18 +465,13 @@ BigNum.prototype.rand = function (to) {
       return this.brand0()
     }
   } else {
-    var x = BigNum.isBigNum(to) ? to.sub(this) : BigNum(to).sub(this)
+    var x = toBigNum(to).sub(this)
     return x.brand0().add(this)
   }
 }
 
 BigNum.prototype.invertm = function (mod) {
-  if (BigNum.isBigNum(mod)) {
-    return this.binvertm(mod)
-  } else {
-    var x = BigNum(mod)
-    return this.binvertm(x)
-  }
+  return this.binvertm(toBigNum(mod))
 }
 
 BigNum.prime = function (bits, safe) {
@@ -285,25 +490,154 @@ BigNum.prototype.probPrime = function (reps) {
   return { 1: true, 0: false }[n]
 }
 
-BigNum.prototype.nextPrime = function () {
-  var num = this
-  do {
-    num = num.add(1)
-  } while (!num.probPrime())
-  return num
+// Runs `run(token, done)` on the native thread pool and adapts the result to
+// either a node-style callback or a Promise. token.cancel() asks the native
+// worker to abort; both forms expose that as `.cancel()`.
+function runAsync (run, cb) {
+  var token = new bin.CancelToken()
+  var cancel = function () { token.cancel() }
+
+  if (typeof cb === 'function') {
+    run(token, cb)
+    return { cancel: cancel }
+  }
+
+  var promise = new Promise(function (resolve, reject) {
+    run(token, function (err, res) {
+      if (err) reject(err)
+      else resolve(res)
+    })
+  })
+  promise.cancel = cancel
+  return promise
+}
+
+BigNum.primeAsync = function (bits, safe, cb) {
+  if (typeof safe === 'function') {
+    cb = safe
+    safe = undefined
+  }
+  if (typeof safe === 'undefined') {
+    safe = true
+  }
+
+  // Force uint32
+  bits >>>= 0
+
+  return runAsync(function (token, done) {
+    BigNum.uprime0Async(bits, !!safe, token, done)
+  }, cb)
+}
+
+BigNum.primeParallel = function (bits, opts, cb) {
+  if (typeof opts === 'function') {
+    cb = opts
+    opts = undefined
+  }
+  opts = opts || {}
+
+  var safe = typeof opts.safe === 'undefined' ? true : !!opts.safe
+  var onProgress = typeof opts.onProgress === 'function' ? opts.onProgress : null
+
+  // Force uint32; zero threads means one per core, and more are capped at
+  // one per core
+  bits >>>= 0
+  var threads = Math.min(opts.threads >>> 0, os.cpus().length || 1)
+
+  return runAsync(function (token, done) {
+    BigNum.uprimeParallel(bits, safe, threads,
+      Number(opts.timeoutMs) || 0, token, onProgress, done)
+  }, cb)
+}
+
+BigNum.prototype.probPrimeAsync = function (reps, cb) {
+  if (typeof reps === 'function') {
+    cb = reps
+    reps = undefined
+  }
+
+  var self = this
+  return runAsync(function (token, done) {
+    self.probprimeAsync(reps || 10, token, function (err, n) {
+      if (err) return done(err)
+      done(null, { 1: true, 0: false }[n])
+    })
+  }, cb)
+}
+
+BigNum.prototype.powmAsync = function (num, mod, cb) {
+  var n = toBigNum(num)
+  var m = toBigNum(mod)
+
+  var self = this
+  return runAsync(function (token, done) {
+    self.bpowmAsync(n, m, token, done)
+  }, cb)
 }
 
+BigNum.prototype.nextPrime = function (reps) {
+  return this.bnextprime(reps >>> 0, false)
+}
+
+BigNum.prototype.prevPrime = function (reps) {
+  return this.bnextprime(reps >>> 0, true)
+}
+
+;[['nextPrimeAsync', false], ['prevPrimeAsync', true]].forEach(function (m) {
+  BigNum.prototype[m[0]] = function (reps, cb) {
+    if (typeof reps === 'function') {
+      cb = reps
+      reps = undefined
+    }
+
+    var self = this
+    return runAsync(function (token, done) {
+      self.bnextprimeAsync(reps >>> 0, m[1], token, done)
+    }, cb)
+  }
+})
+
 BigNum.prototype.isBitSet = function (n) {
   return this.isbitset(n) === 1
 }
 
-BigNum.fromBuffer = function (buf, opts) {
+function bufferOpts (opts) {
   if (!opts) opts = {}
 
   var endian = { 1: 'big', '-1': 'little' }[opts.endian] ||
     opts.endian || 'big'
 
-  var size = opts.size === 'auto' ? Math.ceil(buf.length) : (opts.size || 1)
+  return {
+    little: endian !== 'big',
+    size: opts.size
+  }
+}
+
+BigNum.fromBigInt = function (value) {
+  return BigNum.bfrombigint(value)
+}
+
+BigNum.prototype.toBigInt = function () {
+  return this.btobigint()
+}
+
+// Signed integer encodings; the values match IntFormat in bignum.cc
+var INT_FORMATS = { mpint: 0, der: 1 }
+
+function intFormat (name) {
+  if (!Object.prototype.hasOwnProperty.call(INT_FORMATS, name)) {
+    throw new TypeError('Unsupported integer format ' + name)
+  }
+  return INT_FORMATS[name]
+}
+
+BigNum.fromBuffer = function (buf, opts, offset) {
+  if (typeof opts === 'string') {
+    return BigNum.bdecode(buf, intFormat(opts), offset >>> 0, 1)[0]
+  }
+
+  var o = bufferOpts(opts)
+  var size = o.size === 'auto' ? buf.length : (o.size || 1)
 
   if (buf.length % size !== 0) {
     throw new RangeError('Buffer length (' + buf.length + ')' +
@@ -311,85 +645,130 @@ BigNum.fromBuffer = function (buf, opts) {
     )
   }
 
-  var hex = []
-  for (var i = 0; i < buf.length; i += size) {
-    var chunk = []
-    for (var j = 0; j < size; j++) {
-      chunk.push(buf[i + (endian === 'big' ? j : (size - j - 1))])
-    }
+  return BigNum.frombuffer(buf, size, o.little)
+}
 
-    hex.push(chunk
-      .map(function (c) {
-        return (c < 16 ? '0' : '') + c.toString(16)
-      })
-      .join('')
-    )
+// Decodes consecutive mpints or DER INTEGERs from one buffer. The returned
+// array's bytesRead is how far past opts.offset decoding got.
+BigNum.decodeMany = function (buf, format, opts) {
+  opts = opts || {}
+  return BigNum.bdecode(buf, intFormat(format), opts.offset >>> 0, opts.count >>> 0)
+}
+
+BigNum.fromCompact = function (compact) {
+  return BigNum(0).setCompact(compact)
+}
+
+// Batch entry points. `list` is an array of BigNums, numbers and decimal
+// strings, or a Buffer of packed unsigned integers of `opts.size` bytes each.
+BigNum.sum = function (list, opts) {
+  var o = bufferOpts(opts)
+  return BigNum.bsum(list, o.size >>> 0, o.little)
+}
+
+BigNum.product = function (list, opts) {
+  var o = bufferOpts(opts)
+  return BigNum.bproduct(list, o.size >>> 0, o.little)
+}
+
+'add mul mod'.split(' ').forEach(function (name) {
+  BigNum[name + 'Many'] = function (list, other, opts) {
+    var o = bufferOpts(opts)
+    return BigNum['b' + name + 'many'](list, other, o.size >>> 0, o.little)
   }
+})
 
-  return BigNum(hex.join(''), 16)
+// Lazy expressions: operations on an Expr only record a node. value() turns
+// the DAG into a flat program once and evaluates it in a single native call,
+// so intermediates never get JS wrappers. Opcodes match ExprOp in bignum.cc.
+var EXPR_OPS = {
+  add: 1, sub: 2, mul: 3, div: 4, mod: 5, powm: 6, neg: 7, abs: 8, sqr: 9
 }
 
-BigNum.prototype.toBuffer = function (opts) {
-  if (typeof opts === 'string') {
-    if (opts !== 'mpint') return 'Unsupported Buffer representation'
-
-    var abs = this.abs()
-    var buf = abs.toBuffer({ size: 1, endian: 'big' })
-    var len = buf.length === 1 && buf[0] === 0 ? 0 : buf.length
-    if (buf[0] & 0x80) len++
-
-    var ret = Buffer.alloc(4 + len)
-    if (len > 0) buf.copy(ret, 4 + (buf[0] & 0x80 ? 1 : 0))
-    if (buf[0] & 0x80) ret[4] = 0
-
-    ret[0] = len & (0xff << 24)
-    ret[1] = len & (0xff << 16)
-    ret[2] = len & (0xff << 8)
-    ret[3] = len & (0xff << 0)
-
-    // two's compliment for negative integers:
-    var isNeg = this.lt(0)
-    if (isNeg) {
-      for (var i = 4; i < ret.length; i++) {
-        ret[i] = 0xff - ret[i]
+function Expr (op, args) {
+  this.op = op // 0 for a leaf holding args[0]
+  this.args = args
+  this.program = null
+}
+
+function exprOperand (x) {
+  if (x instanceof Expr) return x
+  return new Expr(0, [toBigNum(x)])
+}
+
+BigNum.expr = function (x) {
+  return exprOperand(x)
+}
+
+Object.keys(EXPR_OPS).forEach(function (name) {
+  Expr.prototype[name] = function () {
+    var args = [this]
+    for (var i = 0; i < arguments.length; i++) {
+      args.push(exprOperand(arguments[i]))
+    }
+    return new Expr(EXPR_OPS[name], args)
+  }
+})
+
+Expr.prototype.compile = function () {
+  var leaves = []
+  var leafIndex = new Map()
+  var nodeIndex = new Map()
+  var code = []
+
+  // Post-order walk; shared subexpressions and repeated leaves get one slot
+  function visit (e) {
+    if (e.op === 0) {
+      if (!leafIndex.has(e.args[0])) {
+        leafIndex.set(e.args[0], leaves.push(e.args[0]) - 1)
       }
+      return -(leafIndex.get(e.args[0]) + 1)
     }
-    ret[4] = (ret[4] & 0x7f) | (isNeg ? 0x80 : 0)
-    if (isNeg) ret[ret.length - 1]++
+    if (nodeIndex.has(e)) return nodeIndex.get(e)
 
-    return ret
+    var refs = e.args.map(visit)
+    code.push(e.op, refs[0] || 0, refs[1] || 0, refs[2] || 0)
+    nodeIndex.set(e, code.length / 4 - 1)
+    return code.length / 4 - 1
   }
 
-  if (!opts) opts = {}
-
-  var endian = { 1: 'big', '-1': 'little' }[opts.endian] ||
-    opts.endian || 'big'
+  visit(this)
+  this.program = { code: new Int32Array(code), leaves: leaves }
+  return this.program
+}
 
-  var hex = this.toString(16)
-  if (hex.charAt(0) === '-') {
-    throw new Error('converting negative numbers to Buffers not supported yet')
-  }
+// Leaves are held by reference, so value() can be called again after
+// changing them in place (iadd, imul, ...) without recompiling
+Expr.prototype.value = function () {
+  if (this.op === 0) return BigNum(this.args[0])
 
-  var size = opts.size === 'auto' ? Math.ceil(hex.length / 2) : (opts.size || 1)
+  var p = this.program || this.compile()
+  return BigNum.bevalexpr(p.code, p.leaves)
+}
 
-  len = Math.ceil(hex.length / (2 * size)) * size
-  buf = Buffer.alloc(len)
+BigNum.prototype.toBuffer = function (opts, offset) {
+  if (typeof opts === 'string') {
+    if (!Object.prototype.hasOwnProperty.call(INT_FORMATS, opts)) return 'Unsupported Buffer representation'
+    return this.bencode(INT_FORMATS[opts])
+  }
 
-  // zero-pad the hex string so the chunks are all `size` long
-  while (hex.length < 2 * len) hex = '0' + hex
+  var target
+  if (Buffer.isBuffer(opts)) {
+    target = opts
+    opts = arguments[2]
+  }
 
-  var hx = hex
-    .split(new RegExp('(.{' + (2 * size) + '})'))
-    .filter(function (s) { return s.length > 0 })
+  if (target && typeof opts === 'string') {
+    return this.bencode(intFormat(opts), target, offset >>> 0)
+  }
 
-  hx.forEach(function (chunk, i) {
-    for (var j = 0; j < size; j++) {
-      var ix = i * size + (endian === 'big' ? j : size - j - 1)
-      buf[ix] = parseInt(chunk.slice(j * 2, j * 2 + 2), 16)
-    }
-  })
+  var o = bufferOpts(opts)
+  var size = o.size === 'auto' ? 0 : (o.size || 1)
 
-  return buf
+  if (target) {
+    return this.tobuffer(size, o.little, target, offset >>> 0)
+  }
+  return this.tobuffer(size, o.little)
 }
 
 Object.keys(BigNum.prototype).forEach(function (name) {
@@ -398,7 +777,7 @@ Object.keys(BigNum.prototype).forEach(function (name) {
   BigNum[name] = function (num) {
     var args = [].slice.call(arguments, 1)
 
-    if (BigNum.isBigNum(num)) {
+    if (num instanceof BigNum || BigNum.isBigNum(num)) {
       return num[name].apply(num, args)
     } else {
       var bigi = BigNum(num)
@@ -0,0 +1,123 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('primeAsync', { timeout: 120000 }, function (t) {
+  BigNum.primeAsync(64, false, function (err, p) {
+    t.ifError(err)
+    t.equal(p.bitLength(), 64)
+    t.ok(p.probPrime())
+
+    BigNum.primeAsync(128).then(function (q) {
+      t.equal(q.bitLength(), 128)
+      t.ok(q.probPrime())
+      t.ok(q.sub(1).div(2).probPrime(), 'safe prime by default')
+      t.end()
+    })
+  })
+})
+
+test('primeAsync cancel', { timeout: 120000 }, function (t) {
+  var job = BigNum.primeAsync(4096, true)
+  job.cancel()
+  job.then(function () {
+    t.fail('cancelled search resolved')
+    t.end()
+  }, function (err) {
+    t.ok(/cancelled/.test(err.message))
+    t.end()
+  })
+})
+
+test('primeParallel', { timeout: 120000 }, function (t) {
+  BigNum.primeParallel(256, { threads: 2 }, function (err, p) {
+    t.ifError(err)
+    t.equal(p.bitLength(), 256)
+    t.ok(p.probPrime())
+    t.ok(p.sub(1).div(2).probPrime(), 'safe prime by default')
+
+    BigNum.primeParallel(128, { safe: false }).then(function (q) {
+      t.equal(q.bitLength(), 128)
+      t.ok(q.probPrime())
+      t.end()
+    })
+  })
+})
+
+test('primeParallel caps threads at one per core', { timeout: 120000 }, function (t) {
+  BigNum.primeParallel(128, { safe: false, threads: 1e6 }).then(function (p) {
+    t.equal(p.bitLength(), 128)
+    t.ok(p.probPrime())
+    t.end()
+  })
+})
+
+test('primeParallel without a usable timeout', { timeout: 120000 }, function (t) {
+  Promise.all([Infinity, 1e300, NaN].map(function (timeoutMs) {
+    return BigNum.primeParallel(128, { safe: false, timeoutMs: timeoutMs })
+  })).then(function (primes) {
+    primes.forEach(function (p) { t.equal(p.bitLength(), 128) })
+    t.end()
+  }, function (err) {
+    t.ifError(err)
+    t.end()
+  })
+})
+
+test('primeParallel timeout and progress', { timeout: 120000 }, function (t) {
+  var reports = []
+  BigNum.primeParallel(4096, {
+    threads: 2,
+    timeoutMs: 300,
+    onProgress: function (counts) { reports.push(counts) }
+  }).then(function () {
+    t.fail('search should have timed out')
+    t.end()
+  }, function (err) {
+    t.ok(/timed out/.test(err.message))
+    t.ok(reports.length > 0, 'progress was reported')
+    var last = reports[reports.length - 1]
+    t.ok(last.tested > 0)
+    t.ok(last.rejected <= last.tested)
+    t.end()
+  })
+})
+
+test('primeParallel cancel', { timeout: 120000 }, function (t) {
+  var job = BigNum.primeParallel(4096)
+  job.cancel()
+  job.then(function () {
+    t.fail('cancelled search resolved')
+    t.end()
+  }, function (err) {
+    t.ok(/cancelled/.test(err.message))
+    t.end()
+  })
+})
+
+test('probPrimeAsync', function (t) {
+  BigNum('170141183460469231731687303715884105727').probPrimeAsync(function (err, res) {
+    t.ifError(err)
+    t.equal(res, true)
+
+    BigNum('170141183460469231731687303715884105729').probPrimeAsync(20).then(function (res) {
+      t.equal(res, false)
+      t.end()
+    })
+  })
+})
+
+test('powmAsync', function (t) {
+  var b = BigNum('123456789012345678901234567890')
+  var e = BigNum('987654321')
+  var m = BigNum('1000000007000000009')
+
+  b.powmAsync(e, m, function (err, res) {
+    t.ifError(err)
+    t.equal(res.toString(), b.powm(e, m).toString())
+
+    b.powmAsync(65537, '1000000007000000009').then(function (res) {
+      t.equal(res.toString(), b.powm(65537, m).toString())
+      t.end()
+    })
+  })
+})
@@ -0,0 +1,72 @@
+var BigNum = require('../')
+var test = require('tap').test
+var Buffer = require('safe-buffer').Buffer
+
+test('sum', function (t) {
+  t.equal(BigNum.sum([]).toString(), '0')
+  t.equal(BigNum.sum([1, '2', BigNum(3), -10]).toString(), '-4')
+
+  var xs = []
+  var expected = BigNum(0)
+  for (var i = 0; i < 1000; i++) {
+    var x = BigNum(2).pow(i % 300).sub(i)
+    xs.push(x)
+    expected = expected.add(x)
+  }
+  t.equal(BigNum.sum(xs).toString(), expected.toString())
+
+  t.end()
+})
+
+test('product', function (t) {
+  t.equal(BigNum.product([]).toString(), '1')
+  t.equal(BigNum.product([7]).toString(), '7')
+  t.equal(BigNum.product([-3, 4, '5']).toString(), '-60')
+
+  var xs = []
+  var expected = BigNum(1)
+  for (var i = 1; i <= 301; i++) {
+    xs.push(i)
+    expected = expected.mul(i)
+  }
+  t.equal(BigNum.product(xs).toString(), expected.toString())
+
+  t.end()
+})
+
+test('elementwise', function (t) {
+  var xs = [BigNum('123456789012345678901234567890'), -7, '42']
+
+  t.deepEqual(BigNum.addMany(xs, 10).map(String),
+    ['123456789012345678901234567900', '3', '52'])
+  t.deepEqual(BigNum.mulMany(xs, [2, 3, BigNum(-1)]).map(String),
+    ['246913578024691357802469135780', '-21', '-42'])
+  t.deepEqual(BigNum.modMany(xs, 1000).map(String), ['890', '-7', '42'])
+
+  t.throws(function () { BigNum.modMany(xs, 0) })
+  t.throws(function () { BigNum.addMany(xs, [1, 2]) })
+  t.throws(function () { BigNum.sum([1, {}]) })
+
+  t.end()
+})
+
+test('packed buffers', function (t) {
+  var buf = Buffer.from([
+    0x00, 0x00, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0xff,
+    0xff, 0xff, 0xff, 0xff
+  ])
+
+  t.equal(BigNum.sum(buf, { size: 4 }).toString(), String(0x100 + 0xff + 0xffffffff))
+  t.equal(BigNum.product(buf, { size: 4 }).toString(),
+    BigNum(0x100).mul(0xff).mul(0xffffffff).toString())
+  t.equal(BigNum.sum(buf, { size: 4, endian: 'little' }).toString(),
+    String(0x10000 + 0xff000000 + 0xffffffff))
+  t.deepEqual(BigNum.addMany(buf, buf, { size: 6 }).map(String),
+    [String(0x1000000 * 2), String(0xffffffffff * 2)])
+
+  t.throws(function () { BigNum.sum(buf) })
+  t.throws(function () { BigNum.sum(buf, { size: 5 }) })
+
+  t.end()
+})
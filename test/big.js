@@ -568,3 +568,68 @@ test('jacobi', { timeout: 120000 }, function (t) {
 
   t.end()
 })
+
+test('create from numbers', { timeout: 120000 }, function (t) {
+  t.equal(BigNum(Math.pow(2, 53)).toString(), '9007199254740992')
+  t.equal(BigNum(-Math.pow(2, 63)).toString(), '-9223372036854775808')
+  t.equal(BigNum(Math.pow(2, 64)).toString(), '18446744073709551616')
+  t.equal(BigNum(-1e21).toString(), '-1000000000000000000000')
+  t.equal(BigNum(1.5).toString(), '1')
+  t.equal(BigNum(-1.5).toString(), '-1')
+  t.equal(
+    BigNum(1.7976931348623157e+308).toString(),
+    BigNum(2).pow(1024).sub(BigNum(2).pow(971)).toString()
+  )
+  t.equal(BigNum(BigNum('-12345678901234567890')).toString(), '-12345678901234567890')
+
+  t.end()
+})
+
+test('toNumber', { timeout: 120000 }, function (t) {
+  t.equal(BigNum(0).toNumber(), 0)
+  t.equal(BigNum('-9007199254740993').toNumber(), -9007199254740992)
+  t.equal(BigNum('9007199254740995').toNumber(), 9007199254740996)
+  t.equal(BigNum('1' + new Array(400).join('0')).toNumber(), Infinity)
+
+  for (var i = 0; i < 200; i++) {
+    var s = String(Math.floor(Math.random() * 9) + 1)
+    for (var j = Math.floor(Math.random() * 40); j > 0; j--) {
+      s += Math.floor(Math.random() * 10)
+    }
+    t.equal(BigNum(s).toNumber(), parseInt(s, 10))
+    t.equal(BigNum('-' + s).toNumber(), -parseInt(s, 10))
+  }
+
+  t.end()
+})
+
+test('radix', { timeout: 120000 }, function (t) {
+  t.equal(BigNum('-101', 2).toString(), '-5')
+  t.equal(BigNum('zz', 36).toString(), '1295')
+  t.equal(BigNum('ZZ', 36).toString(), '1295')
+  t.equal(BigNum(1295).toString(36), 'zz')
+  t.equal(BigNum(-255).toString(2), '-11111111')
+  t.equal(BigNum(0).toString(7), '0')
+  t.equal(BigNum(10).toString(16), '0a')
+
+  var big = BigNum(3).pow(20000).sub(1)
+  for (var base = 2; base <= 36; base++) {
+    var s = big.toString(base)
+    t.equal(BigNum(s, base).toString(), big.toString())
+    if (typeof BigInt === 'function' && base !== 16) {
+      t.equal(s, BigInt(big.toString()).toString(base))
+    }
+  }
+
+  var digits = '9' + new Array(40000).join('1234567890')
+  t.equal(BigNum(digits).toString(), digits)
+
+  t.equal(BigNum('ff', '16').toString(), '255')
+  t.equal(BigNum('ff', undefined).toString(), '0')
+  t.throws(function () { BigNum('10', 37) }, RangeError)
+  t.throws(function () { BigNum('10', 0) }, RangeError)
+  t.throws(function () { BigNum('10', 'hex') }, RangeError)
+  t.throws(function () { BigNum(10).toString(1) })
+
+  t.end()
+})
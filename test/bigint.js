@@ -0,0 +1,35 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+var values = [
+  '0', '1', '-1', '4294967296', '18446744073709551615', '18446744073709551616',
+  '-18446744073709551617', '340282366920938463463374607431768211457',
+  String(BigInt(3) ** BigInt(5000)),
+  '-' + String(BigInt(7) ** BigInt(777))
+]
+
+test('fromBigInt', function (t) {
+  values.forEach(function (v) {
+    t.equal(BigNum.fromBigInt(BigInt(v)).toString(), v)
+    t.equal(BigNum(BigInt(v)).toString(), v)
+  })
+  t.throws(function () { BigNum.fromBigInt(5) })
+
+  t.end()
+})
+
+test('toBigInt', function (t) {
+  values.forEach(function (v) {
+    t.equal(BigNum(v).toBigInt(), BigInt(v))
+  })
+  t.equal(typeof BigNum(10).toBigInt(), 'bigint')
+
+  t.end()
+})
+
+test('BigInt operands', function (t) {
+  t.equal(BigNum(5).add(BigInt(10)).toString(), '15')
+  t.equal(BigNum(5).mul(BigInt('-18446744073709551616')).toString(), '-92233720368547758080')
+
+  t.end()
+})
@@ -0,0 +1,107 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+// Values straddling limb boundaries, signed and unsigned
+var values = [
+  '0', '1', '-1', '255', '-256',
+  '18446744073709551615', '-18446744073709551616',
+  '18446744073709551616', '-18446744073709551615',
+  '340282366920938463463374607431768211455',
+  '-170141183460469231731687303715884105728',
+  '123456789012345678901234567890123456789012345678901234567890',
+  '-98765432109876543210987654321'
+]
+
+test('binary ops match two\'s complement', function (t) {
+  var ops = {
+    and: function (a, b) { return a & b },
+    or: function (a, b) { return a | b },
+    xor: function (a, b) { return a ^ b },
+    andNot: function (a, b) { return a & ~b }
+  }
+
+  values.forEach(function (a) {
+    values.forEach(function (b) {
+      Object.keys(ops).forEach(function (op) {
+        var expected = String(ops[op](BigInt(a), BigInt(b)))
+        t.equal(BigNum(a)[op](b).toString(), expected, a + ' ' + op + ' ' + b)
+      })
+    })
+  })
+
+  t.end()
+})
+
+test('not', function (t) {
+  values.forEach(function (a) {
+    t.equal(BigNum(a).not().toString(), String(~BigInt(a)))
+  })
+
+  var x = BigNum(5)
+  t.equal(x.inot(), x)
+  t.equal(x.toString(), '-6')
+
+  t.end()
+})
+
+test('setBit and clearBit', function (t) {
+  values.forEach(function (a) {
+    [0, 7, 63, 64, 130].forEach(function (n) {
+      var bit = BigInt(1) << BigInt(n)
+      t.equal(BigNum(a).setBit(n).toString(), String(BigInt(a) | bit))
+      t.equal(BigNum(a).clearBit(n).toString(), String(BigInt(a) & ~bit))
+    })
+  })
+
+  var x = BigNum(0)
+  t.equal(x.isetBit(100), x)
+  t.ok(x.isBitSet(100))
+  x.iclearBit(100)
+  t.equal(x.toString(), '0')
+
+  t.end()
+})
+
+test('maskBits', function (t) {
+  values.forEach(function (a) {
+    [0, 1, 8, 64, 65, 200].forEach(function (n) {
+      t.equal(
+        BigNum(a).maskBits(n).toString(),
+        String(BigInt.asUintN(n, BigInt(a))),
+        a + ' maskBits ' + n
+      )
+    })
+  })
+
+  t.end()
+})
+
+test('popcount', function (t) {
+  t.equal(BigNum(0).popcount(), 0)
+  t.equal(BigNum(255).popcount(), 8)
+  t.equal(BigNum(-255).popcount(), 8)
+  t.equal(BigNum(2).pow(1000).sub(1).popcount(), 1000)
+  t.equal(BigNum('123456789012345678901234567890', 10).popcount(),
+    BigInt('123456789012345678901234567890').toString(2).split('1').length - 1)
+
+  t.end()
+})
+
+test('in-place bitmap', function (t) {
+  var bitmap = BigNum(0)
+  for (var i = 0; i < 1000; i += 3) {
+    bitmap.isetBit(i)
+  }
+  t.equal(bitmap.popcount(), 334)
+
+  var evens = BigNum(0)
+  for (i = 0; i < 1000; i += 2) {
+    evens.isetBit(i)
+  }
+  var both = bitmap.and(evens)
+  t.equal(both.popcount(), 167)
+  t.equal(bitmap.iandNot(evens), bitmap)
+  t.equal(bitmap.popcount(), 167)
+
+  t.end()
+})
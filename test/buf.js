@@ -193,3 +193,170 @@ test('toMpint', function (t) {
 
   t.end()
 })
+
+test('toBufTarget', function (t) {
+  var b = BigNum('0102030405060708090a', 16)
+  var target = Buffer.alloc(16, 0xff)
+
+  t.equal(b.toBuffer(target, 2), 10)
+  t.deepEqual(
+    [].slice.call(target),
+    [0xff, 0xff, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 0xff, 0xff, 0xff, 0xff]
+  )
+
+  t.equal(b.toBuffer(target, 0, { endian: 'little', size: 4 }), 12)
+  t.deepEqual(
+    [].slice.call(target, 0, 12),
+    [2, 1, 0, 0, 6, 5, 4, 3, 10, 9, 8, 7]
+  )
+
+  t.throws(function () {
+    b.toBuffer(target, 8)
+  })
+
+  t.end()
+})
+
+test('bufLarge', function (t) {
+  var buf = Buffer.alloc(4096)
+  for (var i = 0; i < buf.length; i++) buf[i] = (i * 7 + 3) & 0xff
+
+  var be = BigNum.fromBuffer(buf)
+  t.equal(be.bitLength(), 4096 * 8 - 6)
+  t.deepEqual(be.toBuffer(), buf)
+
+  var le = BigNum.fromBuffer(buf, { endian: 'little', size: 'auto' })
+  var rev = Buffer.from(buf).reverse()
+  t.equal(le.toString(16), BigNum.fromBuffer(rev).toString(16))
+  t.deepEqual(le.toBuffer({ endian: 'little', size: 'auto' }), buf)
+
+  var le8 = BigNum.fromBuffer(buf, { endian: 'little', size: 8 })
+  t.deepEqual(le8.toBuffer({ endian: 'little', size: 8 }), buf)
+
+  t.deepEqual([].slice.call(BigNum(0).toBuffer({ size: 'auto' })), [0])
+
+  t.end()
+})
+
+test('mpintRoundTrip', function (t) {
+  // Lengths of 256 bytes and more need the upper bytes of the length header
+  var big = BigNum(1).shiftLeft(8 * 300).sub(1)
+  var enc = big.toBuffer('mpint')
+  t.deepEqual([].slice.call(enc, 0, 5), [0x00, 0x00, 0x01, 0x2d, 0x00])
+  t.equal(enc.length, 4 + 301)
+  t.equal(BigNum.fromBuffer(enc, 'mpint').toString(16), big.toString(16))
+
+  // Negative powers of two need no extra sign byte
+  t.deepEqual([].slice.call(BigNum(-0x80).toBuffer('mpint')), [0, 0, 0, 1, 0x80])
+  t.deepEqual([].slice.call(BigNum(-0x100).toBuffer('mpint')), [0, 0, 0, 2, 0xff, 0x00])
+  t.deepEqual([].slice.call(BigNum(-1).toBuffer('mpint')), [0, 0, 0, 1, 0xff])
+
+  ;['0', '1', '-1', '127', '128', '-128', '-129', '255', '-256', '-65536',
+    '-deadbeef', '123456789abcdef0123456789abcdef'].forEach(function (hex) {
+    var n = BigNum(hex, 16)
+    t.equal(BigNum.fromBuffer(n.toBuffer('mpint'), 'mpint').toString(16), n.toString(16))
+  })
+
+  var target = Buffer.alloc(12, 0xee)
+  t.equal(BigNum(-0x1234).toBuffer(target, 3, 'mpint'), 6)
+  t.deepEqual([].slice.call(target),
+    [0xee, 0xee, 0xee, 0, 0, 0, 2, 0xed, 0xcc, 0xee, 0xee, 0xee])
+  t.equal(BigNum.fromBuffer(target, 'mpint', 3).toString(16), '-1234')
+
+  t.throws(function () { BigNum(1).toBuffer(Buffer.alloc(4), 0, 'mpint') })
+  t.throws(function () { BigNum.fromBuffer(Buffer.from([0, 0, 0, 2, 1]), 'mpint') })
+
+  // Redundant sign bytes and a non-empty zero are not minimal (RFC 4251)
+  ;[[0, 0, 0, 1, 0x00], [0, 0, 0, 2, 0x00, 0x01], [0, 0, 0, 2, 0xff, 0x80]].forEach(function (bytes) {
+    t.throws(function () { BigNum.fromBuffer(Buffer.from(bytes), 'mpint') }, RangeError)
+  })
+
+  t.end()
+})
+
+test('der', function (t) {
+  var refs = {
+    0: [0x02, 0x01, 0x00],
+    '7f': [0x02, 0x01, 0x7f],
+    80: [0x02, 0x02, 0x00, 0x80],
+    '-80': [0x02, 0x01, 0x80],
+    '-81': [0x02, 0x02, 0xff, 0x7f],
+    '-1234': [0x02, 0x02, 0xed, 0xcc]
+  }
+
+  Object.keys(refs).forEach(function (hex) {
+    var n = BigNum(hex, 16)
+    t.deepEqual([].slice.call(n.toBuffer('der')), refs[hex], hex)
+    t.equal(BigNum.fromBuffer(Buffer.from(refs[hex]), 'der').toString(16), n.toString(16))
+  })
+
+  // Long form lengths
+  var big = BigNum(1).shiftLeft(8 * 200)
+  var enc = big.toBuffer('der')
+  t.deepEqual([].slice.call(enc, 0, 4), [0x02, 0x81, 0xc9, 0x01])
+  t.equal(BigNum.fromBuffer(enc, 'der').toString(16), big.toString(16))
+  big = BigNum(1).shiftLeft(8 * 300)
+  t.deepEqual([].slice.call(big.toBuffer('der'), 0, 4), [0x02, 0x82, 0x01, 0x2d])
+
+  t.throws(function () { BigNum.fromBuffer(Buffer.from([0x03, 0x01, 0x00]), 'der') })
+  t.throws(function () { BigNum.fromBuffer(Buffer.from([0x02, 0x00]), 'der') })
+  t.throws(function () { BigNum.fromBuffer(Buffer.from([0x02, 0x81]), 'der') })
+
+  // DER requires minimal contents and lengths (X.690 8.3.2, 10.1)
+  ;[[0x02, 0x02, 0x00, 0x01], [0x02, 0x02, 0xff, 0x80], [0x02, 0x81, 0x01, 0x05],
+    [0x02, 0x82, 0x00, 0x01, 0x05]].forEach(function (bytes) {
+    t.throws(function () { BigNum.fromBuffer(Buffer.from(bytes), 'der') }, RangeError)
+  })
+  t.throws(function () { BigNum(1).toBuffer(Buffer.alloc(8), 0, 'pem') })
+
+  t.end()
+})
+
+test('decodeMany', function (t) {
+  var values = [BigNum(0), BigNum(-1), BigNum(0x80), BigNum(-0xdeadbeef), BigNum(3).pow(500)]
+  var buf = Buffer.concat(values.map(function (n) { return n.toBuffer('mpint') }))
+
+  var xs = BigNum.decodeMany(buf, 'mpint')
+  t.deepEqual(xs.map(String), values.map(String))
+  t.equal(xs.bytesRead, buf.length)
+
+  var two = BigNum.decodeMany(buf, 'mpint', { offset: 4, count: 2 })
+  t.deepEqual(two.map(String), ['-1', '128'])
+  t.equal(two.bytesRead, 5 + 6)
+
+  var der = Buffer.concat([BigNum(5).toBuffer('der'), BigNum(-5).toBuffer('der')])
+  t.deepEqual(BigNum.decodeMany(der, 'der').map(String), ['5', '-5'])
+
+  t.throws(function () { BigNum.decodeMany(buf.slice(0, buf.length - 1), 'mpint') })
+  t.throws(function () { BigNum.decodeMany(buf, 'mpint', { count: 6 }) })
+  t.throws(function () { BigNum.decodeMany(buf, 'pem') })
+
+  t.end()
+})
+
+test('compact', function (t) {
+  // Bitcoin's genesis block target and the canonical examples from
+  // arith_uint256_tests
+  var refs = {
+    '1d00ffff': 'ffff0000000000000000000000000000000000000000000000000000',
+    '05009234': '92340000',
+    '04923456': '-12345600',
+    '01003456': '0',
+    '02000056': '0',
+    '20123456': '1234560000000000000000000000000000000000000000000000000000000000'
+  }
+
+  Object.keys(refs).forEach(function (compact) {
+    var n = BigNum.fromCompact(parseInt(compact, 16))
+    t.equal(n.toString(16), refs[compact], compact)
+  })
+
+  t.equal(BigNum('ffff0000000000000000000000000000000000000000000000000000', 16).getCompact(), 0x1d00ffff)
+  t.equal(BigNum(0x80).getCompact(), 0x02008000)
+  t.equal(BigNum(-0x12345600).getCompact(), 0x04923456)
+  t.equal(BigNum(0).getCompact(), 0)
+  t.equal(BigNum('1234560000', 16).getCompact(), 0x05123456)
+  t.equal(BigNum('123456789', 16).getCompact(), 0x05012345)
+
+  t.end()
+})
@@ -0,0 +1,21 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('ctxPoolStats', function (t) {
+  var a = BigNum('123456789012345678901234567890')
+  var m = BigNum('1000000007')
+  var before = BigNum.ctxPoolStats()
+
+  for (var i = 0; i < 100; i++) {
+    a.mul(a).mod(m)
+  }
+
+  var after = BigNum.ctxPoolStats()
+  t.ok(after.acquired - before.acquired >= 200, 'contexts acquired per call')
+  t.ok(after.created - before.created <= 1, 'contexts reused across calls')
+  t.equal(after.inUse, 0)
+  t.ok(after.pooled >= 1)
+  t.ok(after.highWater >= 1)
+
+  t.end()
+})
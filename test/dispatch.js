@@ -0,0 +1,66 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('word operands', function (t) {
+  var big = BigNum('123456789012345678901234567890')
+  var nbig = big.neg()
+
+  // Every sign combination through the word paths agrees with BigNum operands
+  ;[big, nbig, BigNum(0), BigNum(7), BigNum(-7)].forEach(function (x) {
+    ;[1, -1, 3, -3, 0x7fffffff, -0x80000000, 4294967296, -1e15, 2.5, -2.5].forEach(function (n) {
+      var bn = BigNum(n)
+      var label = x + ' ' + n
+      t.equal(x.add(n).toString(), x.add(bn).toString(), label + ' add')
+      t.equal(x.sub(n).toString(), x.sub(bn).toString(), label + ' sub')
+      t.equal(x.mul(n).toString(), x.mul(bn).toString(), label + ' mul')
+      t.equal(x.div(n).toString(), x.div(bn).toString(), label + ' div')
+      t.equal(x.cmp(n), x.cmp(bn), label + ' cmp')
+      if (n < 0) {
+        t.equal(x.mod(n).toString(), x.mod(bn).toString(), label + ' mod')
+      }
+    })
+  })
+
+  // mod by a non-negative number keeps its unsigned result
+  t.equal(BigNum(-7).mod(3).toString(), '1')
+  t.equal(BigNum(-7).mod(BigNum(3)).toString(), '-1')
+
+  // Numbers beyond 64 bits are converted exactly
+  t.equal(BigNum(1).add(1e30).toString(), '1000000000000000019884624838657')
+  t.equal(BigNum(0).cmp(-1e30), 1)
+
+  t.end()
+})
+
+test('other operands', function (t) {
+  t.equal(BigNum(5).add('10').toString(), '15')
+  t.equal(BigNum(5).mul(BigInt(-3)).toString(), '-15')
+  t.equal(BigNum(5).cmp('5'), 0)
+  t.ok(BigNum(5).lt('1000'))
+
+  t.throws(function () { BigNum(5).add(null) }, TypeError)
+  t.throws(function () { BigNum(5).mul({}) }, /Unspecified operation for type object for mul/)
+  t.throws(function () { BigNum(5).div(0) }, RangeError)
+  t.throws(function () { BigNum(5).mod(BigNum(0)) }, RangeError)
+  t.throws(function () { BigNum(5).idiv(0) }, RangeError)
+
+  t.end()
+})
+
+test('in-place', function (t) {
+  var x = BigNum(10)
+  t.equal(x.iadd(5), x)
+  t.equal(x.toString(), '15')
+  t.equal(x.imul(-2).toString(), '-30')
+
+  var out = BigNum(0)
+  t.equal(x.isub(BigNum(12), out), out)
+  t.equal(out.toString(), '-42')
+  t.equal(x.toString(), '-30')
+
+  // A second argument that is not a BigNum is ignored by the plain methods
+  t.equal(x.add(1, out).toString(), '-29')
+  t.equal(out.toString(), '-42')
+
+  t.end()
+})
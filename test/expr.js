@@ -0,0 +1,56 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+var values = [0, 7, -7, BigNum(2).pow(300).add(11), BigNum(3).pow(200).neg()]
+var moduli = [BigNum(13), BigNum(-13), BigNum(2).pow(127).sub(1)]
+
+test('expr matches eager operations', function (t) {
+  values.forEach(function (a) {
+    a = BigNum(a)
+    values.forEach(function (b) {
+      moduli.forEach(function (m) {
+        t.equal(BigNum.expr(a).mul(b).mod(m).value().toString(), a.mul(b).mod(m).toString(),
+          'fused mul+mod ' + a + ' ' + b + ' ' + m)
+        t.equal(BigNum.expr(a).sqr().mod(m).value().toString(), a.mul(a).mod(m).toString())
+        t.equal(BigNum.expr(a).add(b).sub(m).neg().value().toString(), a.add(b).sub(m).neg().toString())
+      })
+    })
+  })
+
+  t.end()
+})
+
+test('expr formula', function (t) {
+  var a = BigNum('98765432109876543210')
+  var b = BigNum('1234567890123')
+  var m = BigNum(2).pow(255).sub(19)
+  var f = BigNum.expr(a).mul(b).add(42).mod(m).powm(65537, m)
+
+  t.equal(f.value().toString(), a.mul(b).add(42).mod(m).powm(65537, m).toString())
+
+  a.iadd(1)
+  t.equal(f.value().toString(), a.mul(b).add(42).mod(m).powm(65537, m).toString(),
+    'leaves are read again on each value()')
+
+  var shared = BigNum.expr(a).mul(b)
+  t.equal(shared.mod(m).add(shared).value().toString(), a.mul(b).mod(m).add(a.mul(b)).toString())
+
+  // An operand of a fused product that is used again after the mod
+  var c = BigNum(987654321)
+  var sum = BigNum.expr(a).add(b)
+  t.equal(sum.mul(c).mod(m).add(sum).value().toString(),
+    a.add(b).mul(c).mod(m).add(a.add(b)).toString())
+
+  var x = BigNum.expr(3)
+  var y = BigNum(3)
+  for (var i = 0; i < 100; i++) {
+    x = x.mul(x).add(i).mod(m)
+    y = y.mul(y).add(i).mod(m)
+  }
+  t.equal(x.value().toString(), y.toString())
+
+  t.equal(BigNum.expr('5').value().toString(), '5')
+  t.throws(function () { BigNum.expr(1).mod(0).value() }, RangeError)
+
+  t.end()
+})
@@ -0,0 +1,57 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+var p = BigNum(2).pow(255).sub(19)
+var F = BigNum.field(p)
+
+function reduce (x) {
+  return BigNum(x).mod(p).add(p).mod(p)
+}
+
+test('field arithmetic', function (t) {
+  var xs = [0, 1, -5, p.sub(1), BigNum(3).pow(300), BigNum(2).pow(254).add(12345)]
+
+  xs.forEach(function (x) {
+    xs.forEach(function (y) {
+      var a = F.element(x)
+      var b = F.element(y)
+      var X = reduce(x)
+      var Y = reduce(y)
+
+      t.equal(a.addm(b).toString(), X.add(Y).mod(p).toString())
+      t.equal(a.subm(b).toString(), X.sub(Y).add(p).mod(p).toString())
+      t.equal(a.mulm(b).toString(), X.mul(Y).mod(p).toString())
+      t.equal(a.eq(b), X.eq(Y))
+    })
+
+    var a = F.element(x)
+    var X = reduce(x)
+    t.equal(a.sqrm().toString(), X.mul(X).mod(p).toString())
+    t.equal(a.negm().toString(), p.sub(X).mod(p).toString())
+    t.equal(a.powm(12345).toString(), X.powm(12345, p).toString())
+    t.equal(a.toBigNum().toString(), X.toString())
+    if (!X.eq(0)) {
+      t.equal(a.invm().toString(), X.invertm(p).toString())
+      t.ok(a.invm().mulm(a).eq(1))
+    }
+  })
+
+  t.end()
+})
+
+test('field in-place and mixed operands', function (t) {
+  var e = F.element(7)
+  t.equal(e.imulm(3), e)
+  e.iaddm('1').isqrm()
+  t.equal(e.toString(), '484')
+  t.equal(F.element(10).mulm(BigNum(2)).toString(16), '14')
+  t.ok(F.zero().isZero())
+  t.ok(F.one().eq(1))
+
+  t.throws(function () { F.zero().invm() }, RangeError)
+  t.throws(function () { F.one().addm(BigNum.field(101).one()) }, TypeError)
+  t.throws(function () { F.one().powm(-1) }, RangeError)
+  t.throws(function () { BigNum.field(100) }, RangeError)
+
+  t.end()
+})
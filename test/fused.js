@@ -0,0 +1,89 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+var big = BigNum('123456789012345678901234567890123')
+
+test('divmod', function (t) {
+  // Inline small values and BIGNUMs, in every sign combination
+  ;[7, -7, 0, 6, big, big.neg()].forEach(function (a) {
+    ;[3, -3, 1, BigNum('98765432109876543210'), BigNum('-98765432109876543210')].forEach(function (d) {
+      a = BigNum(a)
+      d = BigNum(d)
+      var label = a + ' ' + d
+
+      var qr = a.divmod(d)
+      t.equal(qr[0].toString(), a.div(d).toString(), label + ' trunc q')
+      t.equal(qr[1].toString(), a.mod(d).toString(), label + ' trunc r')
+
+      ;['floor', 'euclid'].forEach(function (mode) {
+        var qr = a.divmod(d, mode)
+        t.equal(qr[0].mul(d).add(qr[1]).toString(), a.toString(), label + ' ' + mode)
+        t.ok(qr[1].abs().lt(d.abs()), label + ' ' + mode + ' |r| < |d|')
+        if (mode === 'euclid') {
+          t.ok(qr[1].ge(0), label + ' euclid r >= 0')
+        } else if (!qr[1].eq(0)) {
+          t.equal(qr[1].lt(0), d.lt(0), label + ' floor r has the sign of d')
+        }
+      })
+    })
+  })
+
+  t.deepEqual(BigNum(-7).divmod(2, 'floor').map(String), ['-4', '1'])
+  t.deepEqual(BigNum(7).divmod(-2, 'floor').map(String), ['-4', '-1'])
+  t.deepEqual(BigNum(-7).divmod(-2, 'euclid').map(String), ['4', '1'])
+  t.deepEqual(BigNum.divmod('100', 7).map(String), ['14', '2'])
+
+  t.throws(function () { BigNum(1).divmod(0) }, RangeError)
+  t.throws(function () { BigNum(1).divmod(2, 'ceil') }, TypeError)
+
+  t.end()
+})
+
+test('mulAdd', function (t) {
+  t.equal(BigNum(6).mulAdd(7, -2).toString(), '40')
+  t.equal(big.mulAdd(big, 1).toString(), big.mul(big).add(1).toString())
+  t.equal(BigNum(Math.pow(2, 40)).mulAdd(Math.pow(2, 40), 5).toString(), '1208925819614629174706181')
+
+  var c = BigNum(5)
+  t.equal(BigNum(3).imulAdd(4, c, c), c)
+  t.equal(c.toString(), '17')
+  c = big.add(0)
+  big.imulAdd(2, c, c)
+  t.equal(c.toString(), big.mul(3).toString())
+
+  t.end()
+})
+
+test('modular', function (t) {
+  var m = BigNum('1000000007')
+
+  t.equal(big.mulMod(big, m).toString(), big.mul(big).mod(m).toString())
+  t.equal(BigNum(-3).mulMod(5, 7).toString(), '6')
+  t.equal(BigNum(5).addMod(4, 7).toString(), '2')
+  t.equal(BigNum(-5).addMod(1, 7).toString(), '3')
+  t.equal(BigNum(2).subMod(5, 7).toString(), '4')
+  t.equal(big.subMod(big.add(1), m).toString(), '1000000006')
+
+  var x = BigNum(3)
+  t.equal(x.imulMod(x, 7), x)
+  t.equal(x.toString(), '2')
+  t.equal(x.iaddMod(6, 7).toString(), '1')
+  t.equal(x.isubMod(2, 7).toString(), '6')
+
+  t.throws(function () { BigNum(1).mulMod(2, 0) }, RangeError)
+  t.throws(function () { BigNum(1).addMod(2, 0) }, RangeError)
+
+  t.end()
+})
+
+test('sqr', function (t) {
+  t.equal(BigNum(-12).sqr().toString(), '144')
+  t.equal(BigNum(3037000500).sqr().toString(), '9223372037000250000')
+  t.equal(big.sqr().toString(), big.mul(big).toString())
+
+  var x = BigNum(Math.pow(2, 40))
+  t.equal(x.isqr(), x)
+  t.equal(x.toString(), BigNum(2).pow(80).toString())
+
+  t.end()
+})
@@ -0,0 +1,86 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('in-place arithmetic', function (t) {
+  var big = BigNum('123456789012345678901234567890')
+
+  ;['add', 'sub', 'mul', 'div', 'mod'].forEach(function (op) {
+    [7, -7, '99999999999', BigNum('-314159265358979323846')].forEach(function (arg) {
+      var a = BigNum(big.toString())
+      var expected = big[op](arg).toString()
+      t.equal(a['i' + op](arg), a, 'i' + op + ' returns this')
+      t.equal(a.toString(), expected, 'i' + op + '(' + arg + ')')
+    })
+  })
+
+  t.end()
+})
+
+test('in-place accumulation', function (t) {
+  var sum = BigNum(0)
+  var prod = BigNum(1)
+  for (var i = 1; i <= 50; i++) {
+    sum.iadd(i)
+    prod.imul(i)
+  }
+  t.equal(sum.toString(), '1275')
+  t.equal(
+    prod.toString(),
+    '30414093201713378043612608166064768844377641568960512000000000000'
+  )
+
+  var acc = BigNum(2)
+  acc.iadd(acc)
+  t.equal(acc.toString(), '4', 'self-aliased add')
+  acc.imul(acc)
+  t.equal(acc.toString(), '16', 'self-aliased mul')
+
+  t.end()
+})
+
+test('in-place shifts, sign and bitwise', function (t) {
+  var a = BigNum(5)
+  t.equal(a.ishiftLeft(10).toString(), '5120')
+  t.equal(a.ishiftRight(3).toString(), '640')
+  t.equal(a.ishiftRight(-1).toString(), '1280')
+  t.equal(a.ineg().toString(), '-1280')
+  t.equal(a.iabs().toString(), '1280')
+  t.equal(a.iand(0xff).toString(), String(1280 & 0xff))
+  t.equal(a.ior(0x1001).toString(), String(0x1001))
+  t.equal(a.ixor(1).toString(), String(0x1000))
+
+  t.equal(BigNum(3).shiftRight(BigNum(1)).toString(), '1')
+
+  t.end()
+})
+
+test('in-place powm and out target', function (t) {
+  var m = BigNum('1000000007')
+  var a = BigNum(3)
+  a.ipowm(100, m)
+  t.equal(a.toString(), BigNum(3).powm(100, m).toString())
+  a.ipowm(BigNum(2), m)
+  t.equal(a.toString(), BigNum(3).powm(200, m).toString())
+
+  var out = BigNum(0)
+  var x = BigNum(40)
+  t.equal(x.iadd(2, out), out)
+  t.equal(out.toString(), '42')
+  t.equal(x.toString(), '40', 'operand untouched when out is given')
+  x.imul(x, out)
+  t.equal(out.toString(), '1600')
+  x.ipowm(2, 7, out)
+  t.equal(out.toString(), String(1600 % 7))
+
+  t.end()
+})
+
+test('in-place invalidates cached modulus', function (t) {
+  var m = BigNum(1000003)
+  t.equal(BigNum(10).powm(3, m).toString(), '1000')
+  m.isub(2)
+  t.equal(BigNum(1000).powm(2, m).toString(), String(1000000 % 1000001))
+  m.iadd(6)
+  t.equal(BigNum(1000).powm(2, m).toString(), String(1000000 % 1000007))
+  t.end()
+})
@@ -19,11 +19,11 @@ test('create', function (t) {
   testObj = falsePositive()
   t.equal(BigNum.isBigNum(testObj), true)
 
-  // this causes a hard crash, so its disabled for now
-  // testObj = falsePositive()
-  // t.throws(function() {
-  //     validBn.add(testObj)
-  // })
+  // Arithmetic checks the real type, so a lookalike is rejected
+  testObj = falsePositive()
+  t.throws(function () {
+    validBn.add(testObj)
+  }, TypeError)
 
   t.end()
 })
@@ -35,3 +35,14 @@ function falsePositive () {
   }
   return obj
 }
+
+test('results are instances', function (t) {
+  var res = BigNum(5).add(BigNum(6))
+
+  t.ok(res instanceof BigNum)
+  t.ok(Object.getPrototypeOf(res) === BigNum.prototype)
+  t.equal(BigNum.isBigNum(res), true)
+  t.equal(res.toString(), '11')
+
+  t.end()
+})
@@ -0,0 +1,22 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('memoryUsage', function (t) {
+  var before = BigNum.memoryUsage()
+
+  var xs = []
+  for (var i = 0; i < 10; i++) {
+    xs.push(BigNum(2).pow(80000))
+  }
+
+  var after = BigNum.memoryUsage()
+  t.ok(after.objects - before.objects >= 10, 'live objects counted')
+  t.ok(after.bytes - before.bytes >= 10 * 10000, 'limb storage counted')
+
+  var x = BigNum(1)
+  var small = BigNum.memoryUsage().bytes
+  x.ishiftLeft(80000)
+  t.ok(BigNum.memoryUsage().bytes - small >= 10000, 'in-place growth counted')
+
+  t.end()
+})
@@ -0,0 +1,133 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+var p = BigNum(
+  '179769313486231590772930519078902473361797697894230657273430081157732675805500963132708477322407536021120113879871393357658789768814416622492847430639474124377767893424865485276302219601246094119453082952085005768838150682342462881473913110540827237163350510684586298239947245938479716304835356329624224137859'
+)
+
+test('montgomery powm', function (t) {
+  var mont = BigNum.montgomery(p)
+  var bases = [BigNum(2), BigNum(3).pow(200), p.sub(1), p.add(5), BigNum(-7)]
+  var exps = [BigNum(0), BigNum(1), BigNum(65537), p.sub(2)]
+
+  bases.forEach(function (b) {
+    exps.forEach(function (e) {
+      t.equal(mont.powm(b, e).toString(), b.powm(e, p).toString())
+    })
+  })
+  t.equal(mont.powm(5, 3).toString(), '125')
+  t.throws(function () { mont.powm(3, -1) }, RangeError)
+  t.throws(function () { BigNum.montgomery(11).powm(3, BigNum(-2)) }, RangeError)
+
+  t.end()
+})
+
+test('montgomery mulm sqrm', function (t) {
+  var mont = BigNum.montgomery(p)
+  var a = BigNum(3).pow(600)
+  var b = BigNum(7).pow(300).neg()
+
+  t.equal(mont.mulm(a, b).toString(), a.mul(b).mod(p).add(p).mod(p).toString())
+  t.equal(mont.mulm(12, 13).toString(), '156')
+  t.equal(mont.sqrm(a).toString(), a.mul(a).mod(p).toString())
+  t.equal(mont.sqrm(0).toString(), '0')
+
+  t.end()
+})
+
+test('montgomery rejects even modulus', function (t) {
+  t.throws(function () { BigNum.montgomery(10) })
+  t.throws(function () { BigNum.montgomery(-7) })
+  t.end()
+})
+
+test('powm reuses modulus context', function (t) {
+  var m = BigNum('1000000007')
+  for (var i = 0; i < 10; i++) {
+    t.equal(BigNum(i).powm(3, m).toString(), String(i * i * i))
+  }
+
+  m.setCompact(0x03123457)
+  t.equal(m.toString(), String(0x123457))
+  t.equal(BigNum(1000).powm(2, m).toString(), String(1000000 % 0x123457))
+
+  t.end()
+})
+
+test('fixedBase powm', function (t) {
+  var g = BigNum(3).pow(500)
+  var fb = BigNum.fixedBase(g, p, 256)
+  var exps = [
+    BigNum(0), BigNum(1), BigNum(65537),
+    BigNum(2).pow(256).sub(1), BigNum(2).pow(255).add(12345),
+    p.sub(2) // longer than 256 bits: falls back to an ordinary powm
+  ]
+
+  exps.forEach(function (e) {
+    t.equal(fb.powm(e).toString(), g.powm(e, p).toString())
+  })
+  t.equal(BigNum.fixedBase(-2, 101).powm(7).toString(), BigNum(-2).powm(7, 101).add(101).mod(101).toString())
+
+  t.throws(function () { BigNum.fixedBase(2, 100) })
+  t.throws(function () { fb.powm(-1) })
+
+  t.equal(BigNum.fixedBase(2, 101, 4096).powm(1000).toString(), BigNum(2).powm(1000, 101).toString())
+  t.throws(function () { BigNum.fixedBase(2, 101, 4097) }, RangeError)
+  t.ok(BigNum.fixedBase(2, p, 8 * p.bitLength()))
+  t.throws(function () { BigNum.fixedBase(2, p, 8 * p.bitLength() + 1) }, RangeError)
+  t.throws(function () { BigNum.fixedBase(2, p, 0xffffffff) }, RangeError)
+
+  t.end()
+})
+
+test('multiPowm', function (t) {
+  var a = BigNum(3).pow(500)
+  var b = p.sub(12345)
+  var x = p.sub(2)
+  var y = BigNum(2).pow(300).add(1)
+
+  t.equal(
+    BigNum.multiPowm([[a, x], [b, y]], p).toString(),
+    a.powm(x, p).mul(b.powm(y, p)).mod(p).toString()
+  )
+  t.equal(BigNum.multiPowm([[2, 10], ['3', 4], [BigNum(5), 0]], 1000).toString(), String(1024 * 81 % 1000))
+  t.equal(BigNum.multiPowm([[3, 5], [7, 2]], 100).toString(), '7')
+  t.equal(BigNum.multiPowm([], p).toString(), '1')
+
+  t.throws(function () { BigNum.multiPowm([[2, -1]], p) })
+
+  t.end()
+})
+
+test('crtPowm', function (t) {
+  // RSA key with the primes 2^127 - 1 and 2^89 - 1
+  var kp = BigNum(2).pow(127).sub(1)
+  var kq = BigNum(2).pow(89).sub(1)
+  var n = kp.mul(kq)
+  var e = BigNum(65537)
+  var d = e.invertm(kp.sub(1).mul(kq.sub(1)))
+  var key = {
+    p: kp,
+    q: kq,
+    dp: d.mod(kp.sub(1)),
+    dq: d.mod(kq.sub(1)),
+    qinv: kq.invertm(kp).toString()
+  }
+
+  var m = BigNum('123456789012345678901234567890')
+  var c = m.powm(e, n)
+  t.equal(BigNum.crtPowm(c, key).toString(), m.toString())
+  t.equal(BigNum.crtPowm(c, key, { threads: 2 }).toString(), m.toString())
+  // An inline small base is materialized before the second thread starts
+  t.equal(BigNum.crtPowm(42, key, { threads: 2 }).toString(), BigNum(42).powm(d, n).toString())
+
+  var ctx = BigNum.crtContext(key)
+  ;[0, 1, 2, n.sub(1), n.add(5), BigNum(-3)].forEach(function (x) {
+    t.equal(ctx.powm(x).toString(), BigNum(x).powm(d, n).toString(), 'powm ' + x)
+  })
+
+  t.throws(function () { BigNum.crtContext({ p: 10, q: kq, dp: 1, dq: 1, qinv: 1 }) })
+  t.throws(function () { BigNum.crtContext({ p: kp, q: kq }) })
+
+  t.end()
+})
@@ -0,0 +1,89 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+function isPrime (n) {
+  if (n < 2) return false
+  for (var d = 2; d * d <= n; d++) {
+    if (n % d === 0) return false
+  }
+  return true
+}
+
+test('nextPrime and prevPrime for small values', function (t) {
+  for (var n = -5; n < 1000; n++) {
+    var next = n + 1
+    while (!isPrime(next)) next++
+    t.equal(BigNum(n).nextPrime().toNumber(), next, 'nextPrime ' + n)
+
+    if (n > 2) {
+      var prev = n - 1
+      while (!isPrime(prev)) prev--
+      t.equal(BigNum(n).prevPrime().toNumber(), prev, 'prevPrime ' + n)
+    }
+  }
+
+  t.throws(function () { BigNum(2).prevPrime() })
+  t.throws(function () { BigNum(-7).prevPrime() })
+
+  t.end()
+})
+
+test('nextPrime and prevPrime across word boundaries', function (t) {
+  t.equal(BigNum('4294967291').nextPrime().toString(), '4294967311')
+  t.equal(BigNum('4294967311').prevPrime().toString(), '4294967291')
+  t.equal(BigNum('18446744073709551557').nextPrime().toString(), '18446744073709551629')
+  t.equal(BigNum('18446744073709551629').prevPrime().toString(), '18446744073709551557')
+
+  t.end()
+})
+
+test('nextPrime skips no primes', function (t) {
+  ;[80, 256, 512].forEach(function (bits) {
+    var x = BigNum(2).pow(bits).add(12345)
+    var next = x.nextPrime()
+    t.ok(next.probPrime(), bits + '-bit result is prime')
+    for (var c = x.add(1); c.lt(next); c = c.add(1)) {
+      if (c.probPrime()) t.fail(c.toString() + ' was skipped')
+    }
+
+    var prev = x.prevPrime()
+    t.ok(prev.probPrime(), bits + '-bit result is prime')
+    for (c = x.sub(1); c.gt(prev); c = c.sub(1)) {
+      if (c.probPrime()) t.fail(c.toString() + ' was skipped')
+    }
+  })
+
+  t.end()
+})
+
+test('nextPrime with explicit Miller-Rabin rounds', function (t) {
+  var x = BigNum(2).pow(2048).add(12345)
+  t.equal(x.nextPrime(4).toString(), x.nextPrime().toString())
+  t.equal(x.prevPrime(3).toString(), x.prevPrime().toString())
+  t.end()
+})
+
+test('nextPrimeAsync', { timeout: 120000 }, function (t) {
+  var x = BigNum(2).pow(1023).add(1)
+  x.nextPrimeAsync(function (err, p) {
+    t.ifError(err)
+    t.equal(p.toString(), x.nextPrime().toString())
+
+    x.prevPrimeAsync(20).then(function (q) {
+      t.equal(q.toString(), x.prevPrime().toString())
+      t.end()
+    })
+  })
+})
+
+test('nextPrimeAsync cancel', { timeout: 120000 }, function (t) {
+  var job = BigNum(2).pow(4095).nextPrimeAsync()
+  job.cancel()
+  job.then(function () {
+    t.fail('cancelled search resolved')
+    t.end()
+  }, function (err) {
+    t.ok(/cancelled/.test(err.message))
+    t.end()
+  })
+})
@@ -0,0 +1,99 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('sqrt', function (t) {
+  for (var i = 0; i < 200; i++) {
+    t.equal(BigNum(i).sqrt().toString(), String(Math.floor(Math.sqrt(i))))
+  }
+
+  var big = BigNum(3).pow(1001)
+  var s = big.sqrt()
+  t.ok(s.mul(s).le(big))
+  t.ok(s.add(1).mul(s.add(1)).gt(big))
+
+  var square = BigNum('123456789012345678901234567890').pow(2)
+  t.equal(square.sqrt().toString(), '123456789012345678901234567890')
+  t.equal(square.sub(1).sqrt().toString(), '123456789012345678901234567889')
+
+  t.throws(function () { BigNum(-4).sqrt() })
+
+  t.end()
+})
+
+test('sqrtRem', function (t) {
+  var sr = BigNum(1000).sqrtRem()
+  t.equal(sr[0].toString(), '31')
+  t.equal(sr[1].toString(), '39')
+
+  var big = BigNum(2).pow(4095).add(12345)
+  sr = big.sqrtRem()
+  t.equal(sr[0].mul(sr[0]).add(sr[1]).toString(), big.toString())
+  t.ok(sr[1].le(sr[0].mul(2)))
+
+  t.end()
+})
+
+test('root', function (t) {
+  t.equal(BigNum(27).root(3).toString(), '3')
+  t.equal(BigNum(26).root(3).toString(), '2')
+  t.equal(BigNum(-30).root(3).toString(), '-3')
+  t.equal(BigNum(12345).root(1).toString(), '12345')
+  t.equal(BigNum(2).pow(200).root(3).toString(), '117129523791978766508')
+  t.equal(BigNum(2).pow(4096).root(4096).toString(), '2')
+  t.equal(BigNum(2).pow(4096).sub(1).root(4096).toString(), '1')
+  t.equal(BigNum(7).pow(300).root(BigNum(100)).toString(), '343')
+
+  ;[3, 5, 17, 64, 1000].forEach(function (k) {
+    var big = BigNum(3).pow(2000).add(17)
+    var r = big.root(k)
+    t.ok(r.pow(k).le(big), 'root ' + k + ' is not too big')
+    t.ok(r.add(1).pow(k).gt(big), 'root ' + k + ' is not too small')
+  })
+
+  t.throws(function () { BigNum(-8).root(2) })
+  t.throws(function () { BigNum(8).root(0) })
+
+  t.end()
+})
+
+test('in-place roots', function (t) {
+  var x = BigNum(1000000)
+  t.equal(x.sqrtInPlace(), x)
+  t.equal(x.toString(), '1000')
+  t.equal(x.rootInPlace(3), x)
+  t.equal(x.toString(), '10')
+
+  var out = BigNum(0)
+  t.equal(x.sqrtInPlace(out), out)
+  t.equal(out.toString(), '3')
+  t.equal(x.toString(), '10')
+
+  t.end()
+})
+
+test('isqrt and iroot return new values', function (t) {
+  var x = BigNum(1000000)
+  t.equal(x.isqrt().toString(), '1000')
+  t.equal(x.iroot(3).toString(), '100')
+  t.equal(x.iroot(BigNum(6)).toString(), '10')
+  t.equal(x.toString(), '1000000')
+
+  t.end()
+})
+
+test('isPerfectPower', function (t) {
+  ;[0, 1, -1, 4, 8, -8, 27, 1024, -243].forEach(function (n) {
+    t.ok(BigNum(n).isPerfectPower(), n + ' is a perfect power')
+  })
+  ;[2, 3, 6, -4, 1025, -16].forEach(function (n) {
+    t.notOk(BigNum(n).isPerfectPower(), n + ' is not a perfect power')
+  })
+
+  t.ok(BigNum(3).pow(41).isPerfectPower())
+  t.notOk(BigNum(3).pow(41).add(1).isPerfectPower())
+  t.ok(BigNum(12).pow(20).isPerfectPower())
+  t.notOk(BigNum(12).pow(20).mul(2).isPerfectPower())
+  t.ok(BigNum(2).pow(61).sub(1).pow(6).isPerfectPower())
+
+  t.end()
+})
@@ -0,0 +1,62 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+// Values built from numbers start out inline; the same values parsed from
+// strings are always BIGNUMs, so every result can be checked against them.
+var edges = [
+  0, 1, -1, 2, -3, 255, 0x7fffffff, -0x80000000, 0xffffffff,
+  Math.pow(2, 31), Math.pow(2, 32) + 1, -Math.pow(2, 40),
+  Math.pow(2, 53) - 1, -Math.pow(2, 53), Math.pow(2, 62), -Math.pow(2, 62),
+  Math.pow(2, 63), -Math.pow(2, 63), Math.pow(2, 64)
+]
+
+function big (n) {
+  return BigNum(BigNum(n).toString(16), 16)
+}
+
+test('inline arithmetic matches BIGNUM arithmetic', function (t) {
+  edges.forEach(function (x) {
+    edges.forEach(function (y) {
+      var label = x + ' ' + y
+      ;['add', 'sub', 'mul', 'div', 'mod'].forEach(function (op) {
+        if ((op === 'div' || op === 'mod') && y === 0) return
+        t.equal(BigNum(x)[op](BigNum(y)).toString(), big(x)[op](big(y)).toString(), label + ' ' + op)
+        t.equal(BigNum(x)[op](y).toString(), big(x)[op](y).toString(), label + ' ' + op + ' number')
+      })
+      t.equal(BigNum(x).cmp(y), big(x).cmp(y), label + ' cmp')
+      t.equal(BigNum(x).cmp(BigNum(y)), big(x).cmp(big(y)), label + ' cmp BigNum')
+    })
+
+    ;[1, 7, 31, 62, 63, 64, 100].forEach(function (s) {
+      t.equal(BigNum(x).shiftLeft(s).toString(), big(x).shiftLeft(s).toString(), x + ' << ' + s)
+      t.equal(BigNum(x).shiftRight(s).toString(), big(x).shiftRight(s).toString(), x + ' >> ' + s)
+    })
+
+    t.equal(BigNum(x).neg().toString(), big(x).neg().toString())
+    t.equal(BigNum(x).abs().toString(), big(x).abs().toString())
+    t.equal(BigNum(x).toNumber(), big(x).toNumber())
+    t.equal(BigNum(x).bitLength(), big(x).bitLength())
+    t.equal(BigNum(x).toString(16), big(x).toString(16))
+  })
+
+  t.end()
+})
+
+test('overflow promotes', function (t) {
+  var x = BigNum(Math.pow(2, 62))
+  x.iadd(x).iadd(x)
+  t.equal(x.toString(), '18446744073709551616')
+  x.isub(BigNum('18446744073709551616'))
+  t.equal(x.toString(), '0')
+
+  var f = BigNum(1)
+  for (var i = 1; i <= 25; i++) f.imul(i)
+  t.equal(f.toString(), '15511210043330985984000000')
+
+  // A value moved back into range works inline again
+  f.idiv(f)
+  t.equal(f.add(41).toString(), '42')
+  t.equal(f.powm(3, 5).toString(), '1')
+
+  t.end()
+})
@@ -0,0 +1,31 @@
+var BigNum = require('../')
+var test = require('tap').test
+
+test('stats', function (t) {
+  BigNum.enableStats(false)
+  BigNum.resetStats()
+  BigNum(7).add(BigNum(8))
+  t.same(BigNum.stats(), { enabled: false, methods: {} }, 'nothing recorded while disabled')
+
+  BigNum.enableStats()
+  var a = BigNum(2).pow(1000)
+  var m = BigNum(2).pow(1024).sub(105)
+  for (var i = 0; i < 5; i++) {
+    a.powm(a, m)
+  }
+  a.add(BigNum(1))
+
+  var stats = BigNum.stats()
+  t.equal(stats.enabled, true)
+  t.equal(stats.methods.bpowm.calls, 5)
+  t.ok(stats.methods.bpowm.timeNs > 0)
+  t.equal(stats.methods.bpowm.bits.length, 11, 'operands of up to 2^10 bits')
+  t.equal(stats.methods.bpowm.bits[10], 5)
+  t.equal(stats.methods.add.calls, 1)
+
+  BigNum.resetStats()
+  t.same(BigNum.stats().methods, {})
+  BigNum.enableStats(false)
+
+  t.end()
+})